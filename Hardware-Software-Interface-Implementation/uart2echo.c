@@ -52,6 +52,59 @@ typedef enum {
     STATE_OFF   // "OFF" command recognized
 } State;
 
+/*
+ *  ======== echoStateMachine ========
+ *  Advances the command state machine by one received byte and returns
+ *  the new state. Drives the LED and acknowledges "ON" and "OFF".
+ */
+unsigned char echoStateMachine(unsigned char state, char input, UART2_Handle uart)
+{
+    size_t bytesWritten = 0;
+
+    switch (state) {
+        case STATE_IDLE:
+            // Initial state: waiting for 'O' to start a command
+            if (input == 'O') {
+                state = STATE_O;  // Transition to waiting for "ON" or "OFF"
+            } else {
+                state = STATE_IDLE;  // Stay idle on unexpected input
+            }
+            break;
+
+        case STATE_O:
+            // Received 'O', now waiting for 'N' or 'F'
+            if (input == 'N') {
+                // "ON" detected, turn on the LED
+                GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_ON);
+                UART2_write(uart, "LED ON\r\n", 8, &bytesWritten);
+                state = STATE_IDLE;  // Return to idle state
+            } else if (input == 'F') {
+                state = STATE_F;  // Possible "OFF" command
+            } else {
+                state = STATE_IDLE;  // Reset state
+            }
+            break;
+
+        case STATE_F:
+            // Received 'F', waiting for another 'F' to confirm "OFF"
+            if (input == 'F') {
+                // "OFF" detected, turn off the LED
+                GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF);
+                UART2_write(uart, "LED OFF\r\n", 9, &bytesWritten);
+                state = STATE_IDLE;  // Return to idle state
+            } else {
+                state = STATE_IDLE;  // Reset state
+            }
+            break;
+
+        default:
+            state = STATE_IDLE;  // Default state reset
+            break;
+    }
+
+    return state;
+}
+
 /*
  *  ======== mainThread ========
  */
@@ -97,46 +150,7 @@ void *mainThread(void *arg0)
         }
 
         // State machine logic
-        switch (state) {
-            case STATE_IDLE:
-                // Initial state: waiting for 'O' to start a command
-                if (input == 'O') {
-                    state = STATE_O;  // Transition to waiting for "ON" or "OFF"
-                } else {
-                    state = STATE_IDLE;  // Stay idle on unexpected input
-                }
-                break;
-
-            case STATE_O:
-                // Received 'O', now waiting for 'N' or 'F'
-                if (input == 'N') {
-                    // "ON" detected, turn on the LED
-                    GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_ON);
-                    UART2_write(uart, "LED ON\r\n", 8, &bytesWritten);
-                    state = STATE_IDLE;  // Return to idle state
-                } else if (input == 'F') {
-                    state = STATE_F;  // Possible "OFF" command
-                } else {
-                    state = STATE_IDLE;  // Reset state
-                }
-                break;
-
-            case STATE_F:
-                // Received 'F', waiting for another 'F' to confirm "OFF"
-                if (input == 'F') {
-                    // "OFF" detected, turn off the LED
-                    GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF);
-                    UART2_write(uart, "LED OFF\r\n", 9, &bytesWritten);
-                    state = STATE_IDLE;  // Return to idle state
-                } else {
-                    state = STATE_IDLE;  // Reset state
-                }
-                break;
-
-            default:
-                state = STATE_IDLE;  // Default state reset
-                break;
-        }
+        state = echoStateMachine(state, input, uart);
     }
 }
 
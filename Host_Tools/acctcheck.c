@@ -0,0 +1,191 @@
+/*
+ *  ======== acctcheck.c ========
+ *  Host check of the rolling windows in heataccount.c.
+ *
+ *  Two patterns are ticked through heatAccountTick() for just over two
+ *  days, so every window rolls over many times (60 s, 3600 s and 86400 s):
+ *
+ *    steady  - heater always on, room always below the set-point. The
+ *              expected totals are written out at each rollover, which
+ *              shows what the windows really cover: the current bucket so
+ *              far plus the previous length - 1 full buckets. The "hour"
+ *              reads 3600 s at 3600 s and 3541 s one second later (59 full
+ *              minutes plus 1 s), and climbs back until the next minute.
+ *    mixed   - pseudo-random heater runs and temperatures above, at and
+ *              below the set-point. After every tick, all three windows
+ *              are compared with totals recomputed from the full history.
+ *
+ *  Prints one line per pattern and exits 1 on the first mismatch.
+ *
+ *  Build and run with "make acctcheck && ./acctcheck" from this directory.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "heataccount.h"
+
+/* Definitions */
+#define checkSeconds (2 * 86400 + 3 * 3600 + 61)
+#define setPointQ7 2560             // 20 C
+
+static const char *windowNames[HEAT_WINDOWS] = { "minute", "hour", "day" };
+static const uint32_t bucketSeconds[HEAT_WINDOWS] = { 1, 60, 3600 };
+static const uint32_t bucketCount[HEAT_WINDOWS] = { heatMinuteBuckets, heatHourBuckets, heatDayBuckets };
+
+/*
+ *  ======== Expected Type ========
+ *  Totals of one window after a given number of ticks of the steady pattern.
+ */
+typedef struct expected {
+    uint32_t ticks;
+    int window;
+    uint32_t onTime;
+    uint32_t switches;      // 1 while the window still holds the first second
+} expected;
+
+static heatAccount account;
+static heatTotals history[checkSeconds + 1];    // Running totals after each tick
+
+static bool compare(const char *pattern, uint32_t ticks, int window, const heatTotals *want)
+{
+    const heatTotals *got = heatAccountWindow(&account, window);
+
+    if (got->onTime == want->onTime && got->switches == want->switches
+        && got->above == want->above && got->below == want->below)
+    {
+        return true;
+    }
+
+    printf("%s: %s window after %u s: on %u switches %u above %u below %u, expected %u %u %u %u\n",
+           pattern, windowNames[window], ticks, got->onTime, got->switches, got->above, got->below,
+           want->onTime, want->switches, want->above, want->below);
+    return false;
+}
+
+/*
+ *  ======== checkSteady ========
+ */
+static bool checkSteady(void)
+{
+    static const expected points[] = {
+        { 59, HEAT_MINUTE, 59, 1 },
+        { 60, HEAT_MINUTE, 60, 1 },
+        { 61, HEAT_MINUTE, 60, 0 },
+        { 3599, HEAT_HOUR, 3599, 1 },
+        { 3600, HEAT_HOUR, 3600, 1 },
+        { 3601, HEAT_HOUR, 59 * 60 + 1, 0 },       // Oldest minute dropped whole
+        { 3659, HEAT_HOUR, 59 * 60 + 59, 0 },
+        { 3660, HEAT_HOUR, 3600, 0 },
+        { 3661, HEAT_HOUR, 59 * 60 + 1, 0 },
+        { 86399, HEAT_DAY, 86399, 1 },
+        { 86400, HEAT_DAY, 86400, 1 },
+        { 86401, HEAT_DAY, 23 * 3600 + 1, 0 },     // Oldest hour dropped whole
+        { 89999, HEAT_DAY, 23 * 3600 + 3599, 0 },
+        { 90000, HEAT_DAY, 86400, 0 },
+        { 90001, HEAT_DAY, 23 * 3600 + 1, 0 },
+    };
+    size_t next = 0;
+    uint32_t t;
+
+    heatAccountInit(&account);
+    for (t = 1; t <= checkSeconds && next < sizeof(points) / sizeof(points[0]); ++t)
+    {
+        heatAccountTick(&account, true, setPointQ7 - 64, setPointQ7);
+
+        while (next < sizeof(points) / sizeof(points[0]) && points[next].ticks == t)
+        {
+            heatTotals want;
+
+            want.onTime = points[next].onTime;
+            want.switches = points[next].switches;
+            want.above = 0;
+            want.below = points[next].onTime;
+            if (!compare("steady", t, points[next].window, &want))
+            {
+                return false;
+            }
+            next++;
+        }
+    }
+
+    printf("steady: %u rollover points ok\n", (unsigned int)next);
+    return true;
+}
+
+/*
+ *  ======== checkMixed ========
+ */
+static bool checkMixed(void)
+{
+    uint32_t seed = 12345;
+    uint32_t run = 0;
+    bool heating = false;
+    bool lastHeating = false;
+    uint32_t t;
+    int w;
+
+    heatAccountInit(&account);
+    history[0] = (heatTotals){ 0, 0, 0, 0 };
+    for (t = 1; t <= checkSeconds; ++t)
+    {
+        int16_t temperature;
+
+        // Heater runs and rests of 1 to 600 s; the room wanders +-1 C around the set-point.
+        if (run == 0)
+        {
+            seed = seed * 1103515245u + 12345u;
+            run = 1 + (seed >> 16) % 600;
+            heating = !heating;
+        }
+        run--;
+        seed = seed * 1103515245u + 12345u;
+        temperature = (int16_t)(setPointQ7 + (int)((seed >> 16) % 257) - 128);
+
+        heatAccountTick(&account, heating, temperature, setPointQ7);
+
+        history[t] = history[t - 1];
+        history[t].onTime += heating;
+        history[t].switches += heating && !lastHeating;
+        history[t].above += temperature > setPointQ7;
+        history[t].below += temperature < setPointQ7;
+        lastHeating = heating;
+
+        // A window covers the current bucket so far and the previous length - 1 full buckets.
+        for (w = 0; w < HEAT_WINDOWS; ++w)
+        {
+            uint32_t current = (t - 1) / bucketSeconds[w];
+            uint32_t first = current >= bucketCount[w] - 1 ? current - (bucketCount[w] - 1) : 0;
+            const heatTotals *from = &history[first * bucketSeconds[w]];
+            heatTotals want;
+
+            want.onTime = history[t].onTime - from->onTime;
+            want.switches = history[t].switches - from->switches;
+            want.above = history[t].above - from->above;
+            want.below = history[t].below - from->below;
+
+            if (!compare("mixed", t, w, &want))
+            {
+                return false;
+            }
+        }
+    }
+
+    printf("mixed: %u s, all windows ok every second\n", (unsigned int)checkSeconds);
+    return true;
+}
+
+/*
+ *  ======== main ========
+ */
+int main(void)
+{
+    if (!checkSteady() || !checkMixed())
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,469 @@
+/*
+ *  ======== acquireeval.c ========
+ *  Host comparison of the two temperature acquisition modes against a fake
+ *  TMP116 that models conversion time, the data-ready ALERT pin and the
+ *  sensor's supply current.
+ *
+ *    polling   - the sensor converts continuously at its power-on settings
+ *                (1 s cycle, 8 sample average) and the result register is
+ *                read every checkTemperaturePeriod, ready or not.
+ *    one-shot  - oneshot.c: a conversion is started every oneShotPeriod and
+ *                the result is read when the ALERT pin signals data ready.
+ *                The heat task runs one timer tick after the trigger, as in
+ *                mainThread().
+ *
+ *  The fake sets its Data_Ready flag at the end of every conversion in any
+ *  mode, and only reading the configuration or result register clears it.
+ *  ALERT shows the flag once data-ready mode is configured, and the GPIO
+ *  interrupt sees only falling edges, and only once it is enabled after
+ *  initI2C(). The fake powers up converting continuously. Two more one-shot
+ *  runs check recovery: one where the flag is already set when the
+ *  firmware starts (e.g. after a warm reset), and one where every
+ *  failEvery-th result read fails on the bus.
+ *
+ *  The scheduler is replayed tick by tick: 100 ms timer ticks, the heat
+ *  report's blocking UART write, 400 kHz I2C transfers, and the idle loop
+ *  that services data ready. For one simulated hour the tool reports I2C
+ *  transactions and bytes per hour, reads that returned no new conversion,
+ *  conversions that never signalled data ready, conversion-end-to-read
+ *  latency (mean and worst), conversion time, the age of the reading
+ *  (since its conversion ended) when setHeatMode() uses it (mean and
+ *  worst), and average sensor current.
+ *
+ *  Build and run with "make acquireeval && ./acquireeval" from this directory.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "oneshot.h"
+#include "tasks.h"
+
+/* Definitions */
+#define simulationTicks 36000           // One hour of 100 ms timer ticks
+#define timerPeriodUs (timerPeriod * 1000)
+#define reportWriteUs 1563              // 18 byte report at 115200 baud
+#define i2cByteUs 22.5                  // 9 bit times at 400 kHz
+#define idleLoopUs 2                    // Idle loop pass in mainThread()
+#define tmp116ConfigDefault 0x0220      // Power-on: continuous, 1 s cycle, 8 sample average
+#define activeMicroamps 135.0           // TMP116 datasheet typicals
+#define standbyMicroamps 1.25
+#define shutdownMicroamps 0.25
+#define failEvery 50                    // Failed result reads in the failing-bus run
+
+/*
+ *  ======== Fake TMP116 Type ========
+ */
+typedef struct fakeTmp116 {
+    uint16_t config;
+    uint8_t pointer;
+    int16_t result;
+    bool dataReady;             // Data_Ready flag
+    bool alert;                 // ALERT pin asserted (low)
+    bool interruptEnabled;      // GPIO interrupt on ALERT enabled
+    bool converting;
+    uint32_t conversionEnd;     // us
+    uint32_t nextCycle;         // us, next continuous conversion start
+    uint32_t lastEnd;           // us, when the current result was produced
+    uint32_t completed;         // Conversions completed
+    uint32_t lastUpdate;        // us, for charge accounting
+    double charge;              // uA * us
+} fakeTmp116;
+
+/*
+ *  ======== Run Type ========
+ */
+typedef struct run {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t reads;
+    uint32_t staleReads;
+    uint32_t timeouts;
+    double latencySum;          // us, conversion end to result read
+    double latencyMax;
+    double conversionSum;       // us, conversion start to end
+    uint32_t uses;              // Readings used by the heat task
+    double ageSum;              // us, conversion end to use
+    double ageMax;
+    double microamps;
+} run;
+
+/*
+ *  ======== Scenario Type ========
+ */
+typedef struct scenario {
+    const char *name;
+    bool oneShot;
+    bool flagAtStart;           // Data_Ready already set when the firmware starts
+    bool failingBus;            // Every failEvery-th result read fails
+} scenario;
+
+static fakeTmp116 sensor;
+static oneShotSensor acquisition;
+static uint32_t simulationTime;          // Simulated time (us)
+static bool useOneShot;
+static bool failingBus;
+static uint32_t resultReads;
+
+static uint32_t conversionTime(uint16_t config)
+{
+    static const uint32_t averaging[4] = { 15500, 125000, 500000, 1000000 };
+
+    return averaging[(config >> 5) & 0x3];
+}
+
+static uint32_t cycleTime(uint16_t config)
+{
+    static const uint32_t cycle[8] = { 15500, 125000, 250000, 500000, 1000000, 4000000, 8000000, 16000000 };
+    uint32_t t = cycle[(config >> 7) & 0x7];
+
+    return t > conversionTime(config) ? t : conversionTime(config);
+}
+
+static unsigned int sensorMode(void)
+{
+    return (sensor.config >> 10) & 0x3;
+}
+
+/* Room temperature in Q7, drifting slowly. */
+static int16_t roomTemperature(uint32_t t)
+{
+    return (int16_t)lround((21.0 + 0.5 * sin(t / 600e6)) * 128.0);
+}
+
+/* Charges the supply for the time since the last update. */
+static void fakeCharge(uint32_t t)
+{
+    double current = shutdownMicroamps;
+
+    if (sensor.converting)
+    {
+        current = activeMicroamps;
+    }
+    else if (sensorMode() == 0)
+    {
+        current = standbyMicroamps;
+    }
+    sensor.charge += current * (t - sensor.lastUpdate);
+    sensor.lastUpdate = t;
+}
+
+/*
+ *  ======== fakeAlert ========
+ *  Drives ALERT from the flag and interrupts the main loop on a falling edge.
+ */
+static void fakeAlert(uint32_t t)
+{
+    bool alert = sensor.dataReady && (sensor.config & 0x0004);
+
+    if (alert && !sensor.alert && sensor.interruptEnabled)
+    {
+        uint32_t now = simulationTime;
+
+        simulationTime = t;
+        oneShotDataReady(&acquisition);
+        simulationTime = now;
+    }
+    sensor.alert = alert;
+}
+
+/*
+ *  ======== fakeAdvance ========
+ *  Runs the sensor up to time t, firing the data-ready callback at the
+ *  moment each conversion ends.
+ */
+static void fakeAdvance(uint32_t t)
+{
+    for (;;)
+    {
+        if (!sensor.converting && sensorMode() == 0 && sensor.nextCycle <= t)
+        {
+            fakeCharge(sensor.nextCycle);
+            sensor.converting = true;
+            sensor.conversionEnd = sensor.nextCycle + conversionTime(sensor.config);
+            sensor.nextCycle += cycleTime(sensor.config);
+        }
+        if (!sensor.converting || sensor.conversionEnd > t)
+        {
+            break;
+        }
+
+        fakeCharge(sensor.conversionEnd);
+        sensor.converting = false;
+        sensor.result = roomTemperature(sensor.conversionEnd);
+        sensor.lastEnd = sensor.conversionEnd;
+        sensor.completed++;
+        if (sensorMode() == 3)
+        {
+            sensor.config = (uint16_t)((sensor.config & ~0x0C00) | 0x0400);  // Back to shutdown
+        }
+
+        sensor.dataReady = true;
+        fakeAlert(sensor.lastEnd);
+    }
+    fakeCharge(t);
+}
+
+/*
+ *  ======== fakeTransfer ========
+ *  The I2C side of the fake sensor, also used by the polling baseline.
+ */
+static bool fakeTransfer(void *context, const uint8_t *writeBuf, size_t writeCount,
+                         uint8_t *readBuf, size_t readCount)
+{
+    (void)context;
+
+    simulationTime += (uint32_t)(i2cByteUs * (writeCount + readCount + (writeCount ? 1 : 0) + (readCount ? 1 : 0)));
+    fakeAdvance(simulationTime);
+
+    if (failingBus && readCount == 2 && writeCount >= 1 && writeBuf[0] == tmp11xResultReg
+        && ++resultReads % failEvery == 0)
+    {
+        return false;   // NACK; the sensor never sees the transaction
+    }
+
+    if (writeCount >= 1)
+    {
+        sensor.pointer = writeBuf[0];
+    }
+    if (writeCount == 3 && sensor.pointer == tmp11xConfigReg)
+    {
+        sensor.config = (uint16_t)((writeBuf[1] << 8) | writeBuf[2]);
+        if (sensorMode() == 3 && !sensor.converting)
+        {
+            sensor.converting = true;
+            sensor.conversionEnd = simulationTime + conversionTime(sensor.config);
+        }
+    }
+    if (readCount == 2 && sensor.pointer == tmp11xResultReg)
+    {
+        readBuf[0] = (uint8_t)((uint16_t)sensor.result >> 8);
+        readBuf[1] = (uint8_t)(sensor.result & 0xFF);
+    }
+    if (readCount == 2 && sensor.pointer == tmp11xConfigReg)
+    {
+        readBuf[0] = (uint8_t)(sensor.config >> 8);
+        readBuf[1] = (uint8_t)(sensor.config & 0xFF);
+    }
+    if (readCount && (sensor.pointer == tmp11xResultReg || sensor.pointer == tmp11xConfigReg))
+    {
+        sensor.dataReady = false;   // Reading either register clears the flag
+    }
+    fakeAlert(simulationTime);
+
+    return true;
+}
+
+static uint32_t fakeMicroseconds(void *context)
+{
+    (void)context;
+    return simulationTime;
+}
+
+static const sensorBus fakeBus = { fakeTransfer, fakeMicroseconds, NULL };
+
+/*
+ *  ======== pollRead ========
+ *  What readTemp() does on the bus.
+ */
+static void pollRead(run *r, uint32_t *lastCompleted, uint32_t *heldEnd, bool *held)
+{
+    uint8_t txBuffer[1] = { tmp11xResultReg };
+    uint8_t rxBuffer[2];
+    double latency;
+
+    fakeTransfer(NULL, txBuffer, 1, rxBuffer, 2);
+    r->transactions++;
+    r->bytes += 5;
+    r->reads++;
+
+    if (sensor.completed == *lastCompleted)
+    {
+        r->staleReads++;
+        return;
+    }
+    *lastCompleted = sensor.completed;
+    *heldEnd = sensor.lastEnd;
+    *held = true;
+
+    latency = (double)(simulationTime - sensor.lastEnd);
+    r->latencySum += latency;
+    if (latency > r->latencyMax)
+    {
+        r->latencyMax = latency;
+    }
+    r->conversionSum += conversionTime(sensor.config);
+}
+
+/*
+ *  ======== simulate ========
+ */
+static run simulate(const scenario *s)
+{
+    run r = { 0, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0, 0.0, 0.0, 0.0 };
+    unsigned long temperatureElapsed = s->oneShot ? oneShotPeriod : checkTemperaturePeriod;
+    unsigned long heatElapsed = updateHeatModeAndServerPeriod;
+    uint32_t lastCompleted = 0;
+    uint32_t heldEnd = 0;
+    bool held = false;
+    bool temperatureInit = true;        // TEMPERATURE_SENSOR_INIT
+    uint32_t seconds = 0;               // setHeatMode()'s counter
+    int16_t raw;
+    uint32_t tick;
+
+    useOneShot = s->oneShot;
+    failingBus = s->failingBus;
+    resultReads = 0;
+    simulationTime = 0;
+    sensor.config = tmp116ConfigDefault;
+    sensor.pointer = 0;
+    sensor.result = 0;
+    sensor.dataReady = s->flagAtStart;
+    sensor.alert = false;
+    sensor.interruptEnabled = false;
+    sensor.converting = false;
+    sensor.nextCycle = 0;
+    sensor.lastEnd = 0;
+    sensor.completed = 0;
+    sensor.lastUpdate = 0;
+    sensor.charge = 0.0;
+
+    if (useOneShot)
+    {
+        // initI2C(), then initGPIO() enables the interrupt; the heat task runs one tick behind.
+        oneShotInit(&acquisition, &fakeBus);
+        sensor.interruptEnabled = true;
+        heatElapsed = updateHeatModeAndServerPeriod - timerPeriod;
+    }
+
+    for (tick = 0; tick < simulationTicks; ++tick)
+    {
+        uint32_t tickEnd = (tick + 1) * timerPeriodUs;
+
+        simulationTime = tick * timerPeriodUs > simulationTime ? tick * timerPeriodUs : simulationTime;
+        fakeAdvance(simulationTime);
+
+        // Temperature task; its first tick only leaves TEMPERATURE_SENSOR_INIT
+        if (temperatureElapsed >= (useOneShot ? oneShotPeriod : checkTemperaturePeriod))
+        {
+            if (temperatureInit)
+            {
+                temperatureInit = false;
+            }
+            else if (useOneShot)
+            {
+                oneShotTrigger(&acquisition);
+            }
+            else
+            {
+                pollRead(&r, &lastCompleted, &heldEnd, &held);
+            }
+            temperatureElapsed = 0;
+        }
+        temperatureElapsed += timerPeriod;
+
+        // Heat mode task: uses the latest reading, then the blocking UART report.
+        // Like setHeatMode(), it only counts on its first tick.
+        if (heatElapsed >= updateHeatModeAndServerPeriod)
+        {
+            if (seconds++ != 0)
+            {
+                if (held)
+                {
+                    double age = (double)(simulationTime - heldEnd);
+
+                    r.uses++;
+                    r.ageSum += age;
+                    if (age > r.ageMax)
+                    {
+                        r.ageMax = age;
+                    }
+                }
+                simulationTime += reportWriteUs;
+                fakeAdvance(simulationTime);
+            }
+            heatElapsed = 0;
+        }
+        heatElapsed += timerPeriod;
+
+        // Idle loop until the next timer tick
+        while (useOneShot && simulationTime < tickEnd)
+        {
+            if (acquisition.dataReady)
+            {
+                simulationTime += idleLoopUs;
+                if (oneShotService(&acquisition, &raw))
+                {
+                    heldEnd = sensor.lastEnd;
+                    held = true;
+                }
+            }
+            else if (sensor.converting && sensor.conversionEnd < tickEnd)
+            {
+                simulationTime = sensor.conversionEnd > simulationTime ? sensor.conversionEnd : simulationTime;
+                fakeAdvance(simulationTime);
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    simulationTime = simulationTicks * (uint32_t)timerPeriodUs;
+    fakeAdvance(simulationTime);
+    r.microamps = sensor.charge / simulationTime;
+
+    if (useOneShot)
+    {
+        r.transactions = acquisition.transactions;
+        r.bytes = acquisition.bytes;
+        r.reads = acquisition.conversions;
+        r.staleReads = 0;
+        r.timeouts = acquisition.timeouts;
+        r.latencySum = (double)acquisition.readLatency;
+        r.latencyMax = acquisition.readLatencyMax;
+        r.conversionSum = (double)acquisition.conversionTime;
+    }
+
+    return r;
+}
+
+static void report(const char *name, const run *r)
+{
+    uint32_t fresh = r->reads - r->staleReads;
+
+    printf("%-20s %10u %10u %6u %6u %8u %10.1f %9.1f %8.1f %7.1f %7.1f %9.2f\n", name,
+           r->transactions, r->bytes, r->reads, r->staleReads, r->timeouts,
+           fresh ? r->latencySum / fresh : 0.0, r->latencyMax,
+           fresh ? r->conversionSum / fresh / 1000.0 : 0.0,
+           r->uses ? r->ageSum / r->uses / 1000.0 : 0.0, r->ageMax / 1000.0, r->microamps);
+}
+
+/*
+ *  ======== main ========
+ */
+int main(void)
+{
+    static const scenario scenarios[] = {
+        { "polling",            false, false, false },
+        { "one-shot",           true,  false, false },
+        { "one-shot, flag set", true,  true,  false },
+        { "one-shot, bus fails", true, false, true },
+    };
+    unsigned int i;
+
+    printf("%-20s %10s %10s %6s %6s %8s %10s %9s %8s %7s %7s %9s\n", "mode", "trans/hour",
+           "bytes/hour", "reads", "stale", "timeouts", "latency us", "max us", "conv ms", "age ms",
+           "max ms", "sensor uA");
+    for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); ++i)
+    {
+        run r = simulate(&scenarios[i]);
+
+        report(scenarios[i].name, &r);
+    }
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+#!/bin/sh
+#
+#  ======== benchcheck.sh ========
+#  Runs the firmware micro-benchmarks (microbench) and measures the code
+#  size of the benchmarked functions, then reports, records or checks the
+#  results against bench_baseline.txt.
+#
+#    report      print the current results
+#    baseline    write the current results to the baseline file
+#    check       compare with the baseline; exit 1 if any cycle count or
+#                size grew by more than the threshold
+#
+#  Each time is the minimum over BENCH_RUNS runs of microbench (default 5).
+#  Only cycles/op is gated, against BENCH_THRESHOLD percent (default 25):
+#  it does not move with the clock frequency the host happens to run at.
+#  ns/op is printed alongside for reference. Sizes are gated against
+#  BENCH_SIZE_THRESHOLD percent (default 5). A failing check is measured
+#  again up to BENCH_RETRIES times (default 2), keeping the best time
+#  seen, so a burst of load on the host does not fail the gate while a
+#  real slowdown still does.
+#
+#  The baseline only means something on the machine and compiler that
+#  wrote it, so it is not kept in the tree. Record it with
+#  "make bench-baseline" on the tree before the change under test; check
+#  fails if there is none, rather than comparing the change with itself.
+#
+#  Usage: benchcheck.sh [report|baseline|check]
+#
+
+set -e
+cd "$(dirname "$0")"
+
+MODE=${1:-report}
+BASELINE=${BENCH_BASELINE:-bench_baseline.txt}
+THRESHOLD=${BENCH_THRESHOLD:-25}
+SIZE_THRESHOLD=${BENCH_SIZE_THRESHOLD:-5}
+RUNS=${BENCH_RUNS:-5}
+RETRIES=${BENCH_RETRIES:-2}
+NM=${NM:-nm}
+OBJECTS="gpiointerrupt.o uart2echo.o thermalmodel.o heataccount.o oneshot.o"
+SYMBOLS="readTemp reportToServer runTasks setHeatMode getAmbientTemperature serviceTemperatureReady answerQuery echoStateMachine"
+SYMBOLS="$SYMBOLS thermalModelControl thermalModelUpdate heatAccountTick oneShotTrigger oneShotService"
+
+#
+#  ======== measure ========
+#  Prints "time <name> <ns/op> <cycles/op>" and "size <symbol> <bytes>".
+#  Any earlier microbench output named in $1 is included in the minimum.
+#
+measure()
+{
+    run=0
+    {
+        if [ -n "$1" ]; then
+            cat "$1"
+        fi
+        while [ "$run" -lt "$RUNS" ]; do
+            ./microbench | tee -a "${1:-/dev/null}"
+            run=$((run + 1))
+        done
+    } | awk '
+        /^#/ { next }
+        !($1 in ns) || $2 < ns[$1] { ns[$1] = $2 }
+        !($1 in cycles) || $3 < cycles[$1] { cycles[$1] = $3 }
+        !($1 in seen) { seen[$1] = 1; order[++n] = $1 }
+        END { for (i = 1; i <= n; ++i) printf "time %s %s %s\n", order[i], ns[order[i]], cycles[order[i]] }'
+
+    $NM -S --defined-only $OBJECTS | awk -v symbols="$SYMBOLS" '
+        function hex(s,    i, v) {
+            v = 0
+            s = tolower(s)
+            for (i = 1; i <= length(s); ++i) v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+            return v
+        }
+        BEGIN { n = split(symbols, list, " "); for (i = 1; i <= n; ++i) wanted[list[i]] = 1 }
+        NF == 4 && ($4 in wanted) { printf "size %s %d\n", $4, hex($2) }'
+}
+
+case "$MODE" in
+report)
+    measure
+    ;;
+
+baseline)
+    {
+        echo "# Micro-benchmark baseline written by benchcheck.sh on $(uname -sm)"
+        echo "# $(${CC:-cc} --version | head -n 1)"
+        echo "# time <name> <ns/op> <cycles/op>, size <symbol> <bytes>"
+        measure
+    } > "$BASELINE"
+    cat "$BASELINE"
+    ;;
+
+check)
+    if [ ! -f "$BASELINE" ]; then
+        echo "benchcheck: no baseline $BASELINE; run \"make bench-baseline\" on the tree before the change" >&2
+        exit 1
+    fi
+    runs=$(mktemp)
+    trap 'rm -f "$runs"' EXIT
+    attempt=0
+    while :; do
+        status=0
+        measure "$runs" | awk -v threshold="$THRESHOLD" -v sizeThreshold="$SIZE_THRESHOLD" '
+            function compare(label, base, now, limit,    change, status) {
+                change = base > 0 ? (now - base) * 100 / base : 0
+                status = limit < 0 ? "" : "ok"
+                if (limit >= 0 && base > 0 && change > limit) { status = "REGRESSION"; failed = 1 }
+                printf "%-34s %12.2f %12.2f %+8.1f%%  %s\n", label, base, now, change, status
+            }
+            NR == FNR {
+                if ($1 == "time") { baseNs[$2] = $3; baseCycles[$2] = $4; order[++n] = "time " $2 }
+                if ($1 == "size") { baseSize[$2] = $3; order[++n] = "size " $2 }
+                next
+            }
+            $1 == "time" { ns[$2] = $3; cycles[$2] = $4 }
+            $1 == "size" { size[$2] = $3 }
+            END {
+                printf "%-34s %12s %12s %9s\n", "metric", "baseline", "current", "change"
+                for (i = 1; i <= n; ++i) {
+                    split(order[i], key, " ")
+                    if (key[1] == "time") {
+                        if (!(key[2] in ns)) { printf "%-34s missing\n", key[2]; failed = 1; continue }
+                        compare(key[2] " ns/op", baseNs[key[2]], ns[key[2]], -1)
+                        compare(key[2] " cycles/op", baseCycles[key[2]], cycles[key[2]], threshold)
+                    } else {
+                        if (!(key[2] in size)) { printf "%-34s missing\n", key[2]; failed = 1; continue }
+                        compare(key[2] " bytes", baseSize[key[2]], size[key[2]], sizeThreshold)
+                    }
+                }
+                exit failed
+            }' "$BASELINE" - || status=$?
+        if [ "$status" -eq 0 ] || [ "$attempt" -ge "$RETRIES" ]; then
+            exit "$status"
+        fi
+        attempt=$((attempt + 1))
+        echo "benchcheck: regression, measuring again ($attempt of $RETRIES)"
+    done
+    ;;
+
+*)
+    echo "Usage: $0 [report|baseline|check]" >&2
+    exit 2
+    ;;
+esac
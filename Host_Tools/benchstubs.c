@@ -0,0 +1,215 @@
+/*
+ *  ======== benchstubs.c ========
+ *  Do-nothing SimpleLink drivers for running firmware functions on the host
+ *  (see stubs/). Every call succeeds. I2C reads return a temperature that
+ *  wanders around 21 C so the conversion and control paths see changing
+ *  input, and UART writes are counted so the formatting work is not dead.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/Timer.h>
+#include <ti/drivers/UART.h>
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/ClockP.h>
+
+/* Definitions */
+#define stubSensorBase 0x0A80       // 21 C in Q7
+
+volatile uint32_t stubBytesWritten;  // UART bytes "sent"
+volatile uint32_t stubPinWrites;     // GPIO writes
+static uint32_t stubTransfers;
+static uint32_t stubTicks;
+static int stubDevice;               // Non-NULL handle for every driver
+
+/*
+ *  ======== GPIO ========
+ */
+void GPIO_init(void)
+{
+}
+
+void GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig)
+{
+    (void)index;
+    (void)pinConfig;
+}
+
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback)
+{
+    (void)index;
+    (void)callback;
+}
+
+void GPIO_enableInt(uint_least8_t index)
+{
+    (void)index;
+}
+
+void GPIO_disableInt(uint_least8_t index)
+{
+    (void)index;
+}
+
+void GPIO_write(uint_least8_t index, unsigned int value)
+{
+    (void)index;
+    stubPinWrites += value;
+}
+
+/*
+ *  ======== I2C ========
+ */
+void I2C_init(void)
+{
+}
+
+void I2C_Params_init(I2C_Params *params)
+{
+    params->bitRate = I2C_100kHz;
+}
+
+I2C_Handle I2C_open(uint_least8_t index, I2C_Params *params)
+{
+    (void)index;
+    (void)params;
+    return (I2C_Handle)&stubDevice;
+}
+
+bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction)
+{
+    uint8_t *readBuf = transaction->readBuf;
+    int16_t reading;
+
+    (void)handle;
+
+    stubTransfers++;
+    reading = (int16_t)(stubSensorBase + (int)((stubTransfers >> 3) & 0x7F) - 64);
+    if (transaction->readCount >= 2)
+    {
+        readBuf[0] = (uint8_t)((uint16_t)reading >> 8);
+        readBuf[1] = (uint8_t)(reading & 0xFF);
+    }
+    transaction->status = 0;
+
+    return true;
+}
+
+/*
+ *  ======== Timer ========
+ */
+void Timer_init(void)
+{
+}
+
+void Timer_Params_init(Timer_Params *params)
+{
+    params->timerMode = Timer_ONESHOT_BLOCKING;
+    params->periodUnits = Timer_PERIOD_COUNTS;
+    params->timerCallback = NULL;
+    params->period = 0;
+}
+
+Timer_Handle Timer_open(uint_least8_t index, Timer_Params *params)
+{
+    (void)index;
+    (void)params;
+    return (Timer_Handle)&stubDevice;
+}
+
+int32_t Timer_start(Timer_Handle handle)
+{
+    (void)handle;
+    return Timer_STATUS_SUCCESS;
+}
+
+/*
+ *  ======== UART ========
+ */
+void UART_init(void)
+{
+}
+
+void UART_Params_init(UART_Params *params)
+{
+    params->readMode = UART_MODE_BLOCKING;
+    params->writeMode = UART_MODE_BLOCKING;
+    params->readCallback = NULL;
+    params->writeCallback = NULL;
+    params->readReturnMode = UART_RETURN_FULL;
+    params->readDataMode = UART_DATA_TEXT;
+    params->writeDataMode = UART_DATA_TEXT;
+    params->baudRate = 115200;
+}
+
+UART_Handle UART_open(uint_least8_t index, UART_Params *params)
+{
+    (void)index;
+    (void)params;
+    return (UART_Handle)&stubDevice;
+}
+
+int_fast32_t UART_read(UART_Handle handle, void *buffer, size_t size)
+{
+    (void)handle;
+    (void)buffer;
+    (void)size;
+    return 0;       // Callback mode: nothing has arrived yet
+}
+
+int_fast32_t UART_write(UART_Handle handle, const void *buffer, size_t size)
+{
+    (void)handle;
+    (void)buffer;
+    stubBytesWritten += (uint32_t)size;
+    return (int_fast32_t)size;
+}
+
+/*
+ *  ======== UART2 ========
+ */
+void UART2_Params_init(UART2_Params *params)
+{
+    params->baudRate = 115200;
+}
+
+UART2_Handle UART2_open(uint_least8_t index, UART2_Params *params)
+{
+    (void)index;
+    (void)params;
+    return (UART2_Handle)&stubDevice;
+}
+
+int_fast16_t UART2_read(UART2_Handle handle, void *buffer, size_t size, size_t *bytesRead)
+{
+    (void)handle;
+    (void)buffer;
+    *bytesRead = size;
+    return UART2_STATUS_SUCCESS;
+}
+
+int_fast16_t UART2_write(UART2_Handle handle, const void *buffer, size_t size, size_t *bytesWritten)
+{
+    (void)handle;
+    (void)buffer;
+    stubBytesWritten += (uint32_t)size;
+    *bytesWritten = size;
+    return UART2_STATUS_SUCCESS;
+}
+
+/*
+ *  ======== ClockP ========
+ *  Each query advances the clock by one 10 us tick.
+ */
+uint32_t ClockP_getSystemTicks(void)
+{
+    return ++stubTicks;
+}
+
+uint32_t ClockP_getSystemTickPeriod(void)
+{
+    return 10;
+}
@@ -0,0 +1,123 @@
+/*
+ *  ======== frameparser.c ========
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "frameparser.h"
+
+/*
+ *  ======== frameParserInit ========
+ */
+void frameParserInit(frameParser *parser)
+{
+    parser->field = 0;
+    parser->digits = 0;
+    parser->negative = false;
+    parser->inFrame = false;
+    parser->frames = 0;
+    parser->errors = 0;
+}
+
+/* Starts a new frame after '<'. */
+static void frameStart(frameParser *parser)
+{
+    parser->inFrame = true;
+    parser->field = 0;
+    parser->digits = 0;
+    parser->negative = false;
+    parser->fields[0] = 0;
+}
+
+/* Closes the current field. Returns false if it was empty. */
+static bool frameEndField(frameParser *parser)
+{
+    if (parser->digits == 0)
+    {
+        return false;
+    }
+    if (parser->negative)
+    {
+        parser->fields[parser->field] = -parser->fields[parser->field];
+    }
+    return true;
+}
+
+/* Drops a malformed frame. A '<' restarts straight away. */
+static void frameDrop(frameParser *parser, char c)
+{
+    parser->errors++;
+    parser->inFrame = false;
+    if (c == '<')
+    {
+        frameStart(parser);
+    }
+}
+
+/*
+ *  ======== frameParse ========
+ */
+size_t frameParse(frameParser *parser, const char *data, size_t length, frame *out, bool *complete)
+{
+    size_t i;
+
+    *complete = false;
+
+    for (i = 0; i < length; ++i)
+    {
+        char c = data[i];
+
+        if (!parser->inFrame)
+        {
+            if (c == '<')
+            {
+                frameStart(parser);
+            }
+            continue;
+        }
+
+        if (c >= '0' && c <= '9')
+        {
+            if (parser->digits == frameMaxDigits)
+            {
+                frameDrop(parser, c);
+                continue;
+            }
+            parser->fields[parser->field] = parser->fields[parser->field] * 10 + (c - '0');
+            parser->digits++;
+        }
+        else if (c == '-' && parser->digits == 0 && !parser->negative)
+        {
+            parser->negative = true;
+        }
+        else if (c == ',' && parser->field < frameMaxFields - 1 && frameEndField(parser))
+        {
+            parser->field++;
+            parser->digits = 0;
+            parser->negative = false;
+            parser->fields[parser->field] = 0;
+        }
+        else if (c == '>' && (parser->field == frameMinFields - 1 || parser->field == frameMaxFields - 1)
+                 && frameEndField(parser))
+        {
+            parser->inFrame = false;
+            parser->frames++;
+            out->temperature = parser->fields[0];
+            out->setPoint = parser->fields[1];
+            out->state = parser->fields[2];
+            out->seconds = parser->fields[3];
+            out->fields = (uint8_t)(parser->field + 1);
+            out->onTime = out->fields == frameMaxFields ? parser->fields[4] : 0;
+            out->switches = out->fields == frameMaxFields ? parser->fields[5] : 0;
+            *complete = true;
+            return i + 1;
+        }
+        else
+        {
+            frameDrop(parser, c);
+        }
+    }
+
+    return length;
+}
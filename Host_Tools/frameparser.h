@@ -0,0 +1,67 @@
+/*
+ *  ======== frameparser.h ========
+ *  Incremental parser for the thermostat status report that setHeatMode()
+ *  writes once per second:
+ *
+ *      <temp,set,state,sec>\n\r
+ *
+ *  or, with reportHeatAccounting enabled in the firmware,
+ *
+ *      <temp,set,state,sec,onTime,switches>\n\r
+ *
+ *  where the last two fields cover the device's last hour.
+ *
+ *  Bytes are consumed straight out of the caller's read buffer; fields are
+ *  accumulated as integers, so nothing is copied and a frame may be split
+ *  across any number of reads. Anything outside '<' ... '>' (boot messages,
+ *  line endings, noise) is skipped, and a malformed frame is dropped at the
+ *  first unexpected byte.
+ */
+#ifndef FRAMEPARSER_H_
+#define FRAMEPARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definitions */
+#define frameMinFields 4
+#define frameMaxFields 6
+#define frameMaxDigits 9            // Longest field accepted before the frame is dropped
+
+/*
+ *  ======== Frame Type ========
+ */
+typedef struct frame {
+    int32_t temperature;    // Ambient temperature (C)
+    int32_t setPoint;       // Set-point (C)
+    int32_t state;          // Heater state (HEAT_OFF, HEAT_ON, HEAT_INIT)
+    int32_t seconds;        // Device uptime (s)
+    int32_t onTime;         // Heater on-time over the last hour (s), if present
+    int32_t switches;       // Heater off to on switches over the last hour, if present
+    uint8_t fields;         // Fields in the frame (frameMinFields or frameMaxFields)
+} frame;
+
+/*
+ *  ======== Frame Parser Type ========
+ */
+typedef struct frameParser {
+    int32_t fields[frameMaxFields];
+    uint8_t field;          // Field being parsed
+    uint8_t digits;         // Digits seen in the current field
+    bool negative;          // Current field had a leading '-'
+    bool inFrame;           // Between '<' and '>'
+    uint32_t frames;        // Frames parsed
+    uint32_t errors;        // Frames dropped as malformed
+} frameParser;
+
+void frameParserInit(frameParser *parser);
+
+/*
+ *  Parse up to length bytes and return the number consumed. Parsing stops
+ *  right after a complete frame, which is stored in *out with *complete set;
+ *  call again with the rest of the buffer to continue.
+ */
+size_t frameParse(frameParser *parser, const char *data, size_t length, frame *out, bool *complete);
+
+#endif /* FRAMEPARSER_H_ */
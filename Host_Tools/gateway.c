@@ -0,0 +1,704 @@
+/*
+ *  ======== gateway.c ========
+ *  Linux ingest service for the status reports of many thermostats.
+ *
+ *  Every device link (serial port or pty) named on the command line is
+ *  read through one epoll loop. Bytes are parsed in place by frameParse()
+ *  and each <temp,set,state,sec> or <temp,set,state,sec,onTime,switches>
+ *  frame is appended to the device's columnar ring: one fixed-size array
+ *  per field, so range scans touch only the columns they need and storage
+ *  never grows after start-up.
+ *
+ *  Queries arrive on a local (AF_UNIX) stream socket, one command per line.
+ *  Every reply ends with a line holding only "END".
+ *
+ *      LIST                        index, path and sample count of every device
+ *      LATEST <dev>                newest frame
+ *      RANGE <dev> <from> <to>     frames with from <= sec <= to, oldest first
+ *      STATS <dev> <from> <to>     count, min/max/avg temperature, heater-on share
+ *      INGEST                      frames, malformed frames and bytes received
+ *
+ *  LATEST and RANGE print each frame with the fields it arrived with.
+ *  <dev> is the index reported by LIST. Ranges are found by walking back
+ *  from the newest sample while sec >= from, so after a device reboot
+ *  (sec restarts at 1) only samples since the reboot are reachable by sec.
+ *
+ *  Usage: gateway [-s socket] device...
+ */
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "frameparser.h"
+
+/* Definitions */
+#define seriesCapacity 4096         // Samples kept per device (power of two)
+#define readBufferSize 4096
+#define maxEvents 64
+#define maxQueryLength 128
+#define defaultSocket "thermostat-gateway.sock"
+
+enum ENDPOINT_KINDS {DEVICE_ENDPOINT, LISTEN_ENDPOINT, CLIENT_ENDPOINT};
+
+/*
+ *  ======== Series Type ========
+ *
+ *  Columnar ring of samples for one device.
+ */
+typedef struct series {
+    int16_t *temperature;
+    int16_t *setPoint;
+    uint8_t *state;
+    int32_t *seconds;
+    int16_t *onTime;        // Heater on-time over the last hour (s)
+    int16_t *switches;      // Heater switches over the last hour
+    uint8_t *fields;        // Fields the frame arrived with
+    uint32_t head;          // Total samples written; newest is at (head - 1) % seriesCapacity
+} series;
+
+/*
+ *  ======== Device Type ========
+ */
+typedef struct device {
+    int kind;               // DEVICE_ENDPOINT, must be first
+    int fd;                 // -1 once the link has closed
+    const char *path;
+    frameParser parser;
+    series samples;
+} device;
+
+/*
+ *  ======== Client Type ========
+ */
+typedef struct client {
+    int kind;               // CLIENT_ENDPOINT, must be first
+    int fd;
+    char in[maxQueryLength];
+    size_t inLength;
+    char *out;
+    size_t outLength;
+    size_t outSent;
+    size_t outCapacity;
+} client;
+
+/*
+ *  ======== Global Variables ========
+ */
+static device *devices;
+static unsigned int numDevices;
+static int epollFd;
+static int listenKind = LISTEN_ENDPOINT;
+static uint64_t bytesReceived;
+static volatile sig_atomic_t running = 1;
+
+static void stop(int signal)
+{
+    (void)signal;
+    running = 0;
+}
+
+/*
+ *  ======== seriesInit ========
+ */
+static bool seriesInit(series *s)
+{
+    s->temperature = calloc(seriesCapacity, sizeof(*s->temperature));
+    s->setPoint = calloc(seriesCapacity, sizeof(*s->setPoint));
+    s->state = calloc(seriesCapacity, sizeof(*s->state));
+    s->seconds = calloc(seriesCapacity, sizeof(*s->seconds));
+    s->onTime = calloc(seriesCapacity, sizeof(*s->onTime));
+    s->switches = calloc(seriesCapacity, sizeof(*s->switches));
+    s->fields = calloc(seriesCapacity, sizeof(*s->fields));
+    s->head = 0;
+
+    return s->temperature && s->setPoint && s->state && s->seconds
+           && s->onTime && s->switches && s->fields;
+}
+
+/*
+ *  ======== seriesAppend ========
+ */
+static void seriesAppend(series *s, const frame *f)
+{
+    uint32_t i = s->head & (seriesCapacity - 1);
+
+    s->temperature[i] = (int16_t)f->temperature;
+    s->setPoint[i] = (int16_t)f->setPoint;
+    s->state[i] = (uint8_t)f->state;
+    s->seconds[i] = f->seconds;
+    s->onTime[i] = (int16_t)f->onTime;
+    s->switches[i] = (int16_t)f->switches;
+    s->fields[i] = f->fields;
+    s->head++;
+}
+
+static uint32_t seriesCount(const series *s)
+{
+    return s->head < seriesCapacity ? s->head : seriesCapacity;
+}
+
+/*
+ *  ======== seriesFind ========
+ *  Returns the number of samples, counting back from the newest, whose
+ *  sec is >= from. Those samples are head - n ... head - 1.
+ */
+static uint32_t seriesFind(const series *s, int32_t from)
+{
+    uint32_t count = seriesCount(s);
+    uint32_t n = 0;
+
+    while (n < count && s->seconds[(s->head - n - 1) & (seriesCapacity - 1)] >= from)
+    {
+        n++;
+    }
+
+    return n;
+}
+
+/*
+ *  ======== clientPrintf ========
+ *  Appends formatted text to the client's reply buffer.
+ */
+static void clientPrintf(client *c, const char *format, ...)
+{
+    va_list args;
+    int length;
+
+    for (;;)
+    {
+        size_t space = c->outCapacity - c->outLength;
+
+        va_start(args, format);
+        length = vsnprintf(c->out + c->outLength, space, format, args);
+        va_end(args);
+
+        if (length < 0)
+        {
+            return;
+        }
+        if ((size_t)length < space)
+        {
+            c->outLength += (size_t)length;
+            return;
+        }
+
+        c->outCapacity = c->outCapacity * 2 + (size_t)length;
+        c->out = realloc(c->out, c->outCapacity);
+        if (c->out == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+}
+
+/*
+ *  ======== queryDevice ========
+ *  Parses a device index argument, replying with an error if it is bad.
+ */
+static device *queryDevice(client *c, const char *argument)
+{
+    char *end;
+    unsigned long index = strtoul(argument ? argument : "", &end, 10);
+
+    if (argument == NULL || end == argument || index >= numDevices)
+    {
+        clientPrintf(c, "ERR unknown device\n");
+        return NULL;
+    }
+
+    return &devices[index];
+}
+
+/*
+ *  ======== samplePrint ========
+ *  Queues sample j of s as a frame with the fields it arrived with.
+ */
+static void samplePrint(client *c, const series *s, uint32_t j)
+{
+    if (s->fields[j] == frameMaxFields)
+    {
+        clientPrintf(c, "<%02d,%02d,%d,%04d,%d,%d>\n", s->temperature[j], s->setPoint[j],
+                     s->state[j], s->seconds[j], s->onTime[j], s->switches[j]);
+    }
+    else
+    {
+        clientPrintf(c, "<%02d,%02d,%d,%04d>\n",
+                     s->temperature[j], s->setPoint[j], s->state[j], s->seconds[j]);
+    }
+}
+
+/*
+ *  ======== queryRange ========
+ *  Handles RANGE and STATS, which share their argument parsing.
+ */
+static void queryRange(client *c, bool stats, char **save)
+{
+    device *d = queryDevice(c, strtok_r(NULL, " ", save));
+    const char *from = strtok_r(NULL, " ", save);
+    const char *to = strtok_r(NULL, " ", save);
+    const series *s;
+    int32_t fromSec, toSec;
+    int32_t minimum = INT16_MAX, maximum = INT16_MIN;
+    int64_t sum = 0;
+    uint32_t n, i, count = 0, on = 0;
+
+    if (d == NULL)
+    {
+        return;
+    }
+    if (from == NULL || to == NULL)
+    {
+        clientPrintf(c, "ERR expected <dev> <from> <to>\n");
+        return;
+    }
+
+    s = &d->samples;
+    fromSec = (int32_t)strtol(from, NULL, 10);
+    toSec = (int32_t)strtol(to, NULL, 10);
+    n = seriesFind(s, fromSec);
+
+    for (i = s->head - n; i != s->head; ++i)
+    {
+        uint32_t j = i & (seriesCapacity - 1);
+
+        if (s->seconds[j] > toSec)
+        {
+            continue;
+        }
+        if (!stats)
+        {
+            samplePrint(c, s, j);
+            continue;
+        }
+        count++;
+        sum += s->temperature[j];
+        if (s->temperature[j] < minimum)
+        {
+            minimum = s->temperature[j];
+        }
+        if (s->temperature[j] > maximum)
+        {
+            maximum = s->temperature[j];
+        }
+        if (s->state[j] == 1)
+        {
+            on++;
+        }
+    }
+
+    if (stats && count == 0)
+    {
+        clientPrintf(c, "count=0\n");
+    }
+    else if (stats)
+    {
+        clientPrintf(c, "count=%u min=%d max=%d avg=%.2f on=%.3f\n",
+                     count, minimum, maximum, (double)sum / count, (double)on / count);
+    }
+}
+
+/*
+ *  ======== query ========
+ *  Runs one command line and queues its reply.
+ */
+static void query(client *c, char *line)
+{
+    char *save = NULL;
+    char *command = strtok_r(line, " \r", &save);
+    unsigned int i;
+
+    if (command == NULL)
+    {
+        clientPrintf(c, "ERR empty command\n");
+    }
+    else if (strcmp(command, "LIST") == 0)
+    {
+        for (i = 0; i < numDevices; ++i)
+        {
+            clientPrintf(c, "%u %s %u%s\n", i, devices[i].path, seriesCount(&devices[i].samples),
+                         devices[i].fd < 0 ? " closed" : "");
+        }
+    }
+    else if (strcmp(command, "LATEST") == 0)
+    {
+        device *d = queryDevice(c, strtok_r(NULL, " ", &save));
+
+        if (d != NULL && d->samples.head == 0)
+        {
+            clientPrintf(c, "ERR no samples\n");
+        }
+        else if (d != NULL)
+        {
+            samplePrint(c, &d->samples, (d->samples.head - 1) & (seriesCapacity - 1));
+        }
+    }
+    else if (strcmp(command, "RANGE") == 0)
+    {
+        queryRange(c, false, &save);
+    }
+    else if (strcmp(command, "STATS") == 0)
+    {
+        queryRange(c, true, &save);
+    }
+    else if (strcmp(command, "INGEST") == 0)
+    {
+        uint64_t frames = 0, errors = 0;
+
+        for (i = 0; i < numDevices; ++i)
+        {
+            frames += devices[i].parser.frames;
+            errors += devices[i].parser.errors;
+        }
+        clientPrintf(c, "frames=%llu errors=%llu bytes=%llu\n", (unsigned long long)frames,
+                     (unsigned long long)errors, (unsigned long long)bytesReceived);
+    }
+    else
+    {
+        clientPrintf(c, "ERR unknown command\n");
+    }
+
+    clientPrintf(c, "END\n");
+}
+
+/*
+ *  ======== clientClose ========
+ */
+static void clientClose(client *c)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->out);
+    free(c);
+}
+
+/*
+ *  ======== clientFlush ========
+ *  Sends as much of the queued reply as the socket takes. Returns false if
+ *  the client has gone away.
+ */
+static bool clientFlush(client *c)
+{
+    struct epoll_event event;
+
+    while (c->outSent < c->outLength)
+    {
+        ssize_t sent = send(c->fd, c->out + c->outSent, c->outLength - c->outSent, MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EAGAIN)
+        {
+            break;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        c->outSent += (size_t)sent;
+    }
+
+    if (c->outSent == c->outLength)
+    {
+        c->outLength = 0;
+        c->outSent = 0;
+    }
+
+    // Only wait for writability while there is something left to send.
+    event.events = EPOLLIN | (c->outLength ? EPOLLOUT : 0);
+    event.data.ptr = c;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, c->fd, &event);
+
+    return true;
+}
+
+/*
+ *  ======== clientRead ========
+ *  Collects query lines and answers each complete one.
+ */
+static bool clientRead(client *c)
+{
+    ssize_t received = recv(c->fd, c->in + c->inLength, sizeof(c->in) - c->inLength, 0);
+    char *newline;
+
+    if (received < 0 && errno == EAGAIN)
+    {
+        return true;
+    }
+    if (received <= 0)
+    {
+        return false;
+    }
+    c->inLength += (size_t)received;
+
+    while ((newline = memchr(c->in, '\n', c->inLength)) != NULL)
+    {
+        size_t lineLength = (size_t)(newline - c->in) + 1;
+
+        *newline = '\0';
+        query(c, c->in);
+        memmove(c->in, c->in + lineLength, c->inLength - lineLength);
+        c->inLength -= lineLength;
+    }
+
+    if (c->inLength == sizeof(c->in))
+    {
+        // No newline within maxQueryLength bytes.
+        return false;
+    }
+
+    return clientFlush(c);
+}
+
+/*
+ *  ======== clientAccept ========
+ */
+static void clientAccept(int listenFd)
+{
+    struct epoll_event event;
+    client *c;
+    int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    c = calloc(1, sizeof(*c));
+    if (c == NULL)
+    {
+        close(fd);
+        return;
+    }
+    c->kind = CLIENT_ENDPOINT;
+    c->fd = fd;
+
+    event.events = EPOLLIN;
+    event.data.ptr = c;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/*
+ *  ======== deviceRead ========
+ *  Drains one read's worth of bytes from a device link into its ring.
+ */
+static void deviceRead(device *d)
+{
+    char buffer[readBufferSize];
+    ssize_t received = read(d->fd, buffer, sizeof(buffer));
+    size_t offset = 0;
+
+    if (received < 0 && errno == EAGAIN)
+    {
+        return;
+    }
+    if (received <= 0)
+    {
+        // Link closed (EIO on a pty whose other end went away). Keep its data.
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, d->fd, NULL);
+        close(d->fd);
+        d->fd = -1;
+        return;
+    }
+    bytesReceived += (uint64_t)received;
+
+    while (offset < (size_t)received)
+    {
+        frame f;
+        bool complete;
+
+        offset += frameParse(&d->parser, buffer + offset, (size_t)received - offset, &f, &complete);
+        if (complete)
+        {
+            seriesAppend(&d->samples, &f);
+        }
+    }
+}
+
+/*
+ *  ======== deviceOpen ========
+ *  Opens a link in raw mode at the firmware's 115200 baud.
+ */
+static bool deviceOpen(device *d, const char *path)
+{
+    struct epoll_event event;
+    struct termios tty;
+
+    d->kind = DEVICE_ENDPOINT;
+    d->path = path;
+    d->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (d->fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+
+    if (tcgetattr(d->fd, &tty) == 0)
+    {
+        cfmakeraw(&tty);
+        cfsetspeed(&tty, B115200);
+        tcsetattr(d->fd, TCSANOW, &tty);
+    }
+
+    frameParserInit(&d->parser);
+    if (!seriesInit(&d->samples))
+    {
+        fprintf(stderr, "%s: out of memory\n", path);
+        return false;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = d;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, d->fd, &event) == 0;
+}
+
+/*
+ *  ======== listenOpen ========
+ */
+static int listenOpen(const char *path)
+{
+    struct sockaddr_un address;
+    struct epoll_event event;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || strlen(path) >= sizeof(address.sun_path))
+    {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 16) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = &listenKind;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+
+    return fd;
+}
+
+/*
+ *  ======== main ========
+ */
+int main(int argc, char *argv[])
+{
+    const char *socketPath = defaultSocket;
+    struct epoll_event events[maxEvents];
+    int listenFd;
+    int option;
+    unsigned int i;
+    uint64_t frames = 0;
+
+    while ((option = getopt(argc, argv, "s:")) != -1)
+    {
+        if (option == 's')
+        {
+            socketPath = optarg;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-s socket] device...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-s socket] device...\n", argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    numDevices = (unsigned int)(argc - optind);
+    devices = calloc(numDevices, sizeof(*devices));
+    if (epollFd < 0 || devices == NULL)
+    {
+        perror("gateway");
+        return 1;
+    }
+
+    for (i = 0; i < numDevices; ++i)
+    {
+        if (!deviceOpen(&devices[i], argv[optind + (int)i]))
+        {
+            return 1;
+        }
+    }
+
+    listenFd = listenOpen(socketPath);
+    if (listenFd < 0)
+    {
+        perror(socketPath);
+        return 1;
+    }
+
+    while (running)
+    {
+        int ready = epoll_wait(epollFd, events, maxEvents, -1);
+        int n;
+
+        for (n = 0; n < ready; ++n)
+        {
+            int kind = *(int *)events[n].data.ptr;
+
+            if (kind == DEVICE_ENDPOINT)
+            {
+                deviceRead(events[n].data.ptr);
+            }
+            else if (kind == LISTEN_ENDPOINT)
+            {
+                clientAccept(listenFd);
+            }
+            else
+            {
+                client *c = events[n].data.ptr;
+                bool open = true;
+
+                if (events[n].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    open = clientRead(c);
+                }
+                else if (events[n].events & EPOLLOUT)
+                {
+                    open = clientFlush(c);
+                }
+                if (!open)
+                {
+                    clientClose(c);
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < numDevices; ++i)
+    {
+        frames += devices[i].parser.frames;
+    }
+    fprintf(stderr, "gateway: %u devices, %llu frames, %llu bytes\n", numDevices,
+            (unsigned long long)frames, (unsigned long long)bytesReceived);
+
+    close(listenFd);
+    unlink(socketPath);
+
+    return 0;
+}
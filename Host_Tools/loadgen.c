@@ -0,0 +1,439 @@
+/*
+ *  ======== loadgen.c ========
+ *  Load generator and benchmark for the gateway.
+ *
+ *  Creates one pty per emulated thermostat, starts the gateway on the pty
+ *  slaves and writes <temp,set,state,sec> frames into the masters the way
+ *  setHeatMode() writes them to the UART. When the ingest phase ends it
+ *  reports the frames the gateway stored per second, then times a series
+ *  of LATEST, STATS and RANGE queries over the gateway's socket.
+ *
+ *  Usage: loadgen [-n devices] [-r frames/s per device, 0 = as fast as
+ *         possible] [-t seconds] [-q queries] [-g gateway] [-s socket]
+ *
+ *  Example: ./loadgen -n 500 -r 0 -t 5
+ */
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/* Definitions */
+#define frameBufferSize 512
+#define replyBufferSize (1 << 20)
+#define tickNanoseconds 10000000L       // Pace writes in 10 ms steps
+#define drainPollMicroseconds 10000     // INGEST poll interval once writing stops
+#define drainIdlePolls 10               // Unchanged polls before the gateway counts as drained
+#define defaultSocket "thermostat-gateway.sock"
+
+/*
+ *  ======== Emulated Device Type ========
+ */
+typedef struct emulatedDevice {
+    int master;             // pty master, written by the generator
+    char slave[64];         // pty slave path, opened by the gateway
+    int32_t temperature;
+    int32_t setPoint;
+    int32_t state;
+    int32_t seconds;
+    uint64_t sent;          // Frames written
+    char pending[32];       // Tail of a frame the pty only partly accepted
+    size_t pendingLength;
+} emulatedDevice;
+
+/*
+ *  ======== Query Type ========
+ */
+typedef struct queryKind {
+    const char *name;
+    const char *format;     // printf format taking the device index
+    double *latency;        // Round trip times in microseconds
+    unsigned int count;
+} queryKind;
+
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/*
+ *  ======== ptyOpen ========
+ */
+static bool ptyOpen(emulatedDevice *d, unsigned int index)
+{
+    struct termios tty;
+
+    d->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (d->master < 0 || grantpt(d->master) < 0 || unlockpt(d->master) < 0
+        || ptsname_r(d->master, d->slave, sizeof(d->slave)) != 0)
+    {
+        return false;
+    }
+
+    if (tcgetattr(d->master, &tty) == 0)
+    {
+        cfmakeraw(&tty);
+        tcsetattr(d->master, TCSANOW, &tty);
+    }
+
+    // Spread devices around the set-point so the streams are not identical.
+    d->setPoint = 20 + (int32_t)(index % 5);
+    d->temperature = d->setPoint - 2 + (int32_t)(index % 4);
+    d->state = 0;
+    d->seconds = 1;
+    d->sent = 0;
+    d->pendingLength = 0;
+
+    return true;
+}
+
+/*
+ *  ======== deviceStep ========
+ *  Formats the next frame of a simple bang-bang room into buffer.
+ */
+static int deviceStep(emulatedDevice *d, char *buffer, size_t size)
+{
+    d->state = d->temperature < d->setPoint ? 1 : 0;
+    if (d->seconds % 30 == 0)
+    {
+        d->temperature += d->state ? 1 : -1;
+    }
+
+    return snprintf(buffer, size, "<%02d,%02d,%d,%04d>\n\r",
+                    d->temperature, d->setPoint, d->state, d->seconds++);
+}
+
+/*
+ *  ======== deviceWrite ========
+ *  Writes up to frames frames, stopping when the pty is full (the gateway
+ *  is behind). Returns the number of frames fully written.
+ */
+static uint64_t deviceWrite(emulatedDevice *d, uint64_t frames)
+{
+    char buffer[frameBufferSize];
+    uint64_t written = 0;
+
+    if (d->pendingLength)
+    {
+        ssize_t length = write(d->master, d->pending, d->pendingLength);
+
+        if (length < (ssize_t)d->pendingLength)
+        {
+            if (length > 0)
+            {
+                d->pendingLength -= (size_t)length;
+                memmove(d->pending, d->pending + length, d->pendingLength);
+            }
+            return 0;
+        }
+        d->pendingLength = 0;
+    }
+
+    while (written < frames)
+    {
+        int32_t seconds = d->seconds;
+        int32_t temperature = d->temperature;
+        int length = deviceStep(d, buffer, sizeof(buffer));
+        ssize_t accepted = write(d->master, buffer, (size_t)length);
+
+        if (accepted <= 0)
+        {
+            // Nothing went out; emit the same frame next time.
+            d->seconds = seconds;
+            d->temperature = temperature;
+            break;
+        }
+        written++;
+        if (accepted < length)
+        {
+            d->pendingLength = (size_t)(length - accepted);
+            memcpy(d->pending, buffer + accepted, d->pendingLength);
+            break;
+        }
+    }
+
+    d->sent += written;
+    return written;
+}
+
+/*
+ *  ======== gatewayConnect ========
+ *  Connects to the gateway socket, waiting up to five seconds for it.
+ */
+static int gatewayConnect(const char *path)
+{
+    struct sockaddr_un address;
+    int attempt;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+    for (attempt = 0; attempt < 500; ++attempt)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0)
+        {
+            return fd;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        usleep(10000);
+    }
+
+    return -1;
+}
+
+/*
+ *  ======== gatewayQuery ========
+ *  Sends one command and reads the reply up to its END line.
+ *  Returns the reply length, or -1 on error.
+ */
+static long gatewayQuery(int fd, const char *command, char *reply, size_t size)
+{
+    size_t length = 0;
+
+    if (send(fd, command, strlen(command), MSG_NOSIGNAL) < 0)
+    {
+        return -1;
+    }
+
+    while (length < size - 1)
+    {
+        ssize_t received = recv(fd, reply + length, size - 1 - length, 0);
+
+        if (received <= 0)
+        {
+            return -1;
+        }
+        length += (size_t)received;
+        reply[length] = '\0';
+
+        if (length >= 4 && strcmp(reply + length - 4, "END\n") == 0
+            && (length == 4 || reply[length - 5] == '\n'))
+        {
+            return (long)length;
+        }
+    }
+
+    return -1;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ *  ======== main ========
+ */
+int main(int argc, char *argv[])
+{
+    const char *gateway = "./gateway";
+    const char *socketPath = defaultSocket;
+    unsigned int numDevices = 100;
+    unsigned int rate = 1;
+    unsigned int duration = 10;
+    unsigned int numQueries = 3000;
+    emulatedDevice *devices;
+    char **gatewayArgs;
+    char *reply;
+    char command[128];
+    queryKind kinds[] = {
+        { "LATEST", "LATEST %u\n", NULL, 0 },
+        { "STATS",  "STATS %u 0 2147483647\n", NULL, 0 },
+        { "RANGE",  "RANGE %u 0 2147483647\n", NULL, 0 },
+    };
+    unsigned int numKinds = sizeof(kinds) / sizeof(kinds[0]);
+    unsigned long long frames = 0, errors = 0, bytes = 0;
+    uint64_t sent = 0;
+    double start, elapsed;
+    pid_t child;
+    int option;
+    int fd;
+    unsigned int i, k, idle;
+
+    while ((option = getopt(argc, argv, "n:r:t:q:g:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n': numDevices = (unsigned int)atoi(optarg); break;
+            case 'r': rate = (unsigned int)atoi(optarg); break;
+            case 't': duration = (unsigned int)atoi(optarg); break;
+            case 'q': numQueries = (unsigned int)atoi(optarg); break;
+            case 'g': gateway = optarg; break;
+            case 's': socketPath = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n devices] [-r rate] [-t seconds] [-q queries]"
+                                " [-g gateway] [-s socket]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (numDevices == 0)
+    {
+        return 2;
+    }
+
+    devices = calloc(numDevices, sizeof(*devices));
+    gatewayArgs = calloc(numDevices + 4, sizeof(*gatewayArgs));
+    reply = malloc(replyBufferSize);
+    if (devices == NULL || gatewayArgs == NULL || reply == NULL)
+    {
+        perror("loadgen");
+        return 1;
+    }
+
+    // Create the emulated devices and start the gateway on their pty slaves.
+    gatewayArgs[0] = (char *)gateway;
+    gatewayArgs[1] = "-s";
+    gatewayArgs[2] = (char *)socketPath;
+    for (i = 0; i < numDevices; ++i)
+    {
+        if (!ptyOpen(&devices[i], i))
+        {
+            perror("pty");
+            return 1;
+        }
+        gatewayArgs[i + 3] = devices[i].slave;
+    }
+
+    child = fork();
+    if (child == 0)
+    {
+        execv(gateway, gatewayArgs);
+        perror(gateway);
+        _exit(127);
+    }
+
+    fd = gatewayConnect(socketPath);
+    if (fd < 0)
+    {
+        fprintf(stderr, "loadgen: gateway did not start\n");
+        kill(child, SIGTERM);
+        return 1;
+    }
+
+    // Ingest phase.
+    start = now();
+    elapsed = 0.0;
+    while (elapsed < duration)
+    {
+        struct timespec tick = { 0, tickNanoseconds };
+
+        for (i = 0; i < numDevices; ++i)
+        {
+            uint64_t due = rate ? (uint64_t)(elapsed * rate) + 1 : UINT64_MAX;
+
+            if (devices[i].sent < due)
+            {
+                sent += deviceWrite(&devices[i], due - devices[i].sent);
+            }
+        }
+        if (rate)
+        {
+            nanosleep(&tick, NULL);
+        }
+        elapsed = now() - start;
+    }
+
+    // Finish frames the ptys only partly accepted, then let the gateway
+    // drain what is still queued.
+    for (i = 0; i < numDevices; ++i)
+    {
+        int attempt;
+
+        for (attempt = 0; devices[i].pendingLength && attempt < 100; ++attempt)
+        {
+            deviceWrite(&devices[i], 0);
+            usleep(1000);
+        }
+    }
+    // The ingest time runs until the poll that first saw the final count,
+    // so frames drained after the write loop are counted against the time
+    // it took to store them.
+    for (idle = 0; idle < drainIdlePolls && frames < sent; )
+    {
+        unsigned long long previous = frames;
+
+        usleep(drainPollMicroseconds);
+        if (gatewayQuery(fd, "INGEST\n", reply, replyBufferSize) < 0
+            || sscanf(reply, "frames=%llu errors=%llu bytes=%llu", &frames, &errors, &bytes) != 3)
+        {
+            fprintf(stderr, "loadgen: INGEST failed\n");
+            break;
+        }
+        if (frames == previous)
+        {
+            idle++;
+        }
+        else
+        {
+            idle = 0;
+            elapsed = now() - start;
+        }
+    }
+
+    printf("ingest: %u devices, %.1f s, %llu frames sent, %llu stored, %llu malformed\n",
+           numDevices, elapsed, (unsigned long long)sent, frames, errors);
+    printf("ingest: %.0f frames/s, %.2f MB/s\n", frames / elapsed, bytes / elapsed / 1e6);
+
+    // Query phase, round robin over devices and query kinds.
+    for (k = 0; k < numKinds; ++k)
+    {
+        kinds[k].latency = calloc(numQueries, sizeof(double));
+    }
+    for (i = 0; i < numQueries; ++i)
+    {
+        queryKind *q = &kinds[i % numKinds];
+        double t;
+
+        snprintf(command, sizeof(command), q->format, i % numDevices);
+        t = now();
+        if (gatewayQuery(fd, command, reply, replyBufferSize) < 0)
+        {
+            fprintf(stderr, "loadgen: %s failed\n", q->name);
+            break;
+        }
+        q->latency[q->count++] = (now() - t) * 1e6;
+    }
+
+    for (k = 0; k < numKinds; ++k)
+    {
+        queryKind *q = &kinds[k];
+
+        if (q->count == 0)
+        {
+            continue;
+        }
+        qsort(q->latency, q->count, sizeof(double), compareDouble);
+        printf("query %-6s: %u runs, p50 %.1f us, p99 %.1f us, max %.1f us\n", q->name, q->count,
+               q->latency[q->count / 2], q->latency[q->count * 99 / 100], q->latency[q->count - 1]);
+    }
+
+    close(fd);
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+
+    return 0;
+}
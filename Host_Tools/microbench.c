@@ -0,0 +1,282 @@
+/*
+ *  ======== microbench.c ========
+ *  Micro-benchmarks for the firmware's hot paths, run on the host against
+ *  the stub drivers in benchstubs.c. The firmware sources are compiled
+ *  unchanged (uart2echo.c with its mainThread renamed).
+ *
+ *    readTemp          one polled sensor read and Q7 conversion
+ *    reportToServer    formatting and writing one status report
+ *    schedulerTick     one pass of mainThread()'s loop: runTasks() over the
+ *                      table built by initTasks(), the data-ready callback
+ *                      when a conversion is outstanding, and
+ *                      serviceTemperatureReady()
+ *    echoStateMachine  one received byte through the uart2echo.c state machine
+ *
+ *  Each benchmark is calibrated to batches of at least benchBatchNs, then
+ *  run benchRepeats times; the fastest batch is reported, which filters out
+ *  preemption and cache warm-up. Cycles come from the CPU cycle counter
+ *  (perf_event_open) or, where that is not permitted, from the TSC.
+ *
+ *  Output, one line per benchmark (lines starting with # are comments):
+ *
+ *      <name> <ns/op> <cycles/op>
+ *
+ *  Host numbers say nothing absolute about the CC3220S (80 MHz Cortex-M4,
+ *  soft-float); they are for catching regressions. See benchcheck.sh.
+ *
+ *  Build and run with "make bench" from this directory.
+ */
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <ti/drivers/UART2.h>
+
+#include "ti_drivers_config.h"
+#include "thermalmodel.h"
+#include "oneshot.h"
+#include "heataccount.h"
+#include "tasks.h"
+
+/* Definitions */
+#define benchBatchNs 2000000.0          // Minimum batch length
+#define benchRepeats 25
+
+/*
+ *  ======== Benchmark Type ========
+ */
+typedef struct benchmark {
+    const char *name;
+    void (*body)(unsigned long iterations);
+} benchmark;
+
+/* Firmware under test (gpiointerrupt.c, uart2echo.c) */
+extern thermalModel roomModel;
+extern heatAccount heatAccounting;
+extern oneShotSensor tmpSensor;
+extern bool sensorOneShot;
+void initUART(void);
+void initI2C(void);
+int16_t readTemp(void);
+void reportToServer(int state);
+void serviceTemperatureReady(void);
+void gpioTemperatureReadyCallback(uint_least8_t index);
+unsigned char echoStateMachine(unsigned char state, char input, UART2_Handle uart);
+
+static volatile int32_t sink;           // Keeps results alive
+static task tasks[numTasks];
+static int cycleCounter = -1;           // perf_event fd, or -1 for the TSC
+
+/*
+ *  ======== Benchmark Bodies ========
+ */
+static void benchReadTemp(unsigned long iterations)
+{
+    unsigned long i;
+
+    for (i = 0; i < iterations; ++i)
+    {
+        sink += readTemp();
+    }
+}
+
+static void benchReportToServer(unsigned long iterations)
+{
+    unsigned long i;
+
+    for (i = 0; i < iterations; ++i)
+    {
+        reportToServer((int)(i & 1));
+    }
+}
+
+static void benchSchedulerTick(unsigned long iterations)
+{
+    unsigned long i;
+
+    for (i = 0; i < iterations; ++i)
+    {
+        runTasks(tasks);
+
+        // The sensor answers before the next timer tick.
+        if (tmpSensor.converting)
+        {
+            gpioTemperatureReadyCallback(CONFIG_GPIO_TMP_ALERT);
+        }
+        serviceTemperatureReady();
+    }
+}
+
+static void benchEchoStateMachine(unsigned long iterations)
+{
+    static const char input[] = "ON\r\nOFF\r\nOOFX";
+    UART2_Handle uart = (UART2_Handle)&sink;
+    unsigned char state = 0;
+    unsigned long i;
+    size_t j = 0;
+
+    for (i = 0; i < iterations; ++i)
+    {
+        state = echoStateMachine(state, input[j], uart);
+        if (++j == sizeof(input) - 1)
+        {
+            j = 0;
+        }
+    }
+    sink += state;
+}
+
+static const benchmark benchmarks[] = {
+    { "readTemp", benchReadTemp },
+    { "reportToServer", benchReportToServer },
+    { "schedulerTick", benchSchedulerTick },
+    { "echoStateMachine", benchEchoStateMachine }
+};
+
+/*
+ *  ======== Timing ========
+ */
+static double nanoseconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* Opens the CPU cycle counter for this thread; falls back to the TSC. */
+static const char *cycleCounterOpen(void)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cycleCounter = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (cycleCounter >= 0)
+    {
+        return "cpu-cycles";
+    }
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    return "tsc";
+#else
+    return "none";
+#endif
+}
+
+static uint64_t cycles(void)
+{
+    uint64_t count = 0;
+
+    if (cycleCounter >= 0)
+    {
+        if (read(cycleCounter, &count, sizeof(count)) != sizeof(count))
+        {
+            count = 0;
+        }
+        return count;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    count = __rdtsc();
+#endif
+    return count;
+}
+
+/*
+ *  ======== measure ========
+ *  Grows the batch until it takes benchBatchNs, then keeps the fastest of
+ *  benchRepeats batches.
+ */
+static void measure(const benchmark *b, double *nsPerOp, double *cyclesPerOp)
+{
+    unsigned long iterations = 1;
+    double start, elapsed;
+    uint64_t startCycles, elapsedCycles;
+    int r;
+
+    for (;;)
+    {
+        start = nanoseconds();
+        b->body(iterations);
+        elapsed = nanoseconds() - start;
+        if (elapsed >= benchBatchNs)
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    *nsPerOp = elapsed / iterations;
+    *cyclesPerOp = 0.0;
+    for (r = 0; r < benchRepeats; ++r)
+    {
+        startCycles = cycles();
+        start = nanoseconds();
+        b->body(iterations);
+        elapsed = nanoseconds() - start;
+        elapsedCycles = cycles() - startCycles;
+
+        if (elapsed / iterations < *nsPerOp)
+        {
+            *nsPerOp = elapsed / iterations;
+        }
+        if (r == 0 || (double)elapsedCycles / iterations < *cyclesPerOp)
+        {
+            *cyclesPerOp = (double)elapsedCycles / iterations;
+        }
+    }
+}
+
+/*
+ *  ======== benchInit ========
+ *  Brings the firmware up as mainThread() would, without the GPIO and
+ *  timer set-up (the stubs never call back).
+ */
+static void benchInit(void)
+{
+    initUART();
+    initI2C();
+    thermalModelInit(&roomModel);
+    heatAccountInit(&heatAccounting);
+    initTasks(tasks);
+}
+
+/*
+ *  ======== main ========
+ */
+int main(void)
+{
+    const char *counter;
+    double ns, cyclesPerOp;
+    size_t i;
+
+    benchInit();
+    counter = cycleCounterOpen();
+
+    printf("# %s, sensor %s\n", counter, sensorOneShot ? "one-shot" : "polled");
+    printf("# %-16s %10s %10s\n", "name", "ns/op", "cycles/op");
+    for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i)
+    {
+        measure(&benchmarks[i], &ns, &cyclesPerOp);
+        printf("%-18s %10.2f %10.1f\n", benchmarks[i].name, ns, cyclesPerOp);
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ *  ======== GPIO.h ========
+ *  Host stand-in for the subset of the SimpleLink GPIO driver the firmware
+ *  uses. Implemented by benchstubs.c.
+ */
+#ifndef ti_drivers_GPIO__include
+#define ti_drivers_GPIO__include
+
+#include <stdint.h>
+
+#define GPIO_CFG_OUT_STD 0x0001
+#define GPIO_CFG_OUT_LOW 0x0002
+#define GPIO_CFG_IN_NOPULL 0x0004
+#define GPIO_CFG_IN_PU 0x0008
+#define GPIO_CFG_IN_INT_FALLING 0x0010
+#define GPIO_CFG_IN_INT_RISING 0x0020
+
+typedef uint32_t GPIO_PinConfig;
+typedef void (*GPIO_CallbackFxn)(uint_least8_t index);
+
+void GPIO_init(void);
+void GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig);
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback);
+void GPIO_enableInt(uint_least8_t index);
+void GPIO_disableInt(uint_least8_t index);
+void GPIO_write(uint_least8_t index, unsigned int value);
+
+#endif /* ti_drivers_GPIO__include */
@@ -0,0 +1,38 @@
+/*
+ *  ======== I2C.h ========
+ *  Host stand-in for the subset of the SimpleLink I2C driver the firmware
+ *  uses. Implemented by benchstubs.c.
+ */
+#ifndef ti_drivers_I2C__include
+#define ti_drivers_I2C__include
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    I2C_100kHz = 0,
+    I2C_400kHz = 1
+} I2C_BitRate;
+
+typedef struct I2C_Config *I2C_Handle;
+
+typedef struct {
+    I2C_BitRate bitRate;
+} I2C_Params;
+
+typedef struct {
+    void *writeBuf;
+    size_t writeCount;
+    void *readBuf;
+    size_t readCount;
+    uint_least8_t slaveAddress;
+    int status;                 // int_fast16_t, which is int on the target
+} I2C_Transaction;
+
+void I2C_init(void);
+void I2C_Params_init(I2C_Params *params);
+I2C_Handle I2C_open(uint_least8_t index, I2C_Params *params);
+bool I2C_transfer(I2C_Handle handle, I2C_Transaction *transaction);
+
+#endif /* ti_drivers_I2C__include */
@@ -0,0 +1,47 @@
+/*
+ *  ======== UART.h ========
+ *  Host stand-in for the subset of the SimpleLink UART driver the firmware
+ *  uses. Implemented by benchstubs.c.
+ */
+#ifndef ti_drivers_UART__include
+#define ti_drivers_UART__include
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct UART_Config *UART_Handle;
+typedef void (*UART_Callback)(UART_Handle handle, void *buf, size_t count);
+
+typedef enum {
+    UART_MODE_BLOCKING,
+    UART_MODE_CALLBACK
+} UART_Mode;
+
+typedef enum {
+    UART_RETURN_PARTIAL,
+    UART_RETURN_FULL
+} UART_ReturnMode;
+
+typedef enum {
+    UART_DATA_BINARY = 0,
+    UART_DATA_TEXT = 1
+} UART_DataMode;
+
+typedef struct {
+    UART_Mode readMode;
+    UART_Mode writeMode;
+    UART_Callback readCallback;
+    UART_Callback writeCallback;
+    UART_ReturnMode readReturnMode;
+    UART_DataMode readDataMode;
+    UART_DataMode writeDataMode;
+    uint32_t baudRate;
+} UART_Params;
+
+void UART_init(void);
+void UART_Params_init(UART_Params *params);
+UART_Handle UART_open(uint_least8_t index, UART_Params *params);
+int_fast32_t UART_read(UART_Handle handle, void *buffer, size_t size);
+int_fast32_t UART_write(UART_Handle handle, const void *buffer, size_t size);
+
+#endif /* ti_drivers_UART__include */
@@ -0,0 +1,25 @@
+/*
+ *  ======== UART2.h ========
+ *  Host stand-in for the subset of the SimpleLink UART2 driver uart2echo.c
+ *  uses. Implemented by benchstubs.c.
+ */
+#ifndef ti_drivers_UART2__include
+#define ti_drivers_UART2__include
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UART2_STATUS_SUCCESS 0
+
+typedef struct UART2_Config *UART2_Handle;
+
+typedef struct {
+    uint32_t baudRate;
+} UART2_Params;
+
+void UART2_Params_init(UART2_Params *params);
+UART2_Handle UART2_open(uint_least8_t index, UART2_Params *params);
+int_fast16_t UART2_read(UART2_Handle handle, void *buffer, size_t size, size_t *bytesRead);
+int_fast16_t UART2_write(UART2_Handle handle, const void *buffer, size_t size, size_t *bytesWritten);
+
+#endif /* ti_drivers_UART2__include */
@@ -0,0 +1,14 @@
+/*
+ *  ======== ClockP.h ========
+ *  Host stand-in for the ClockP tick queries used by the sensor bus.
+ *  Implemented by benchstubs.c.
+ */
+#ifndef ti_dpl_ClockP__include
+#define ti_dpl_ClockP__include
+
+#include <stdint.h>
+
+uint32_t ClockP_getSystemTicks(void);
+uint32_t ClockP_getSystemTickPeriod(void);
+
+#endif /* ti_dpl_ClockP__include */
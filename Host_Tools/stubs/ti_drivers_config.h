@@ -0,0 +1,21 @@
+/*
+ *  ======== ti_drivers_config.h ========
+ *  Host stand-in for the SysConfig generated board configuration, used by
+ *  the micro-benchmarks. Indices match gpiointerrupt.syscfg.
+ */
+#ifndef ti_drivers_config_h
+#define ti_drivers_config_h
+
+#define CONFIG_GPIO_LED_0 0
+#define CONFIG_GPIO_BUTTON_0 1
+#define CONFIG_GPIO_BUTTON_1 2
+#define CONFIG_GPIO_TMP_ALERT 3
+#define CONFIG_GPIO_LED_ON 1
+#define CONFIG_GPIO_LED_OFF 0
+
+#define CONFIG_I2C_0 0
+#define CONFIG_TIMER_0 0
+#define CONFIG_UART_0 0
+#define CONFIG_UART2_0 0
+
+#endif /* ti_drivers_config_h */
@@ -0,0 +1,253 @@
+/*
+ *  ======== thermaleval.c ========
+ *  Host evaluation of the model-based heat controller (setHeatMode() with
+ *  usePredictiveHeat) against the plain comparator setHeatMode() uses by
+ *  default, and against a comparator holding the same band as the model
+ *  (preheatHysteresis wide, centered on the set-point) without looking
+ *  ahead, so the effect of the model can be told apart from the effect of
+ *  the band.
+ *
+ *  At the default settings the model beats the same-band comparator on
+ *  comfort error and overshoot in every room, but not the plain
+ *  comparator, which holds the room closer by switching the heater every
+ *  few seconds. That is why usePredictiveHeat defaults to 0.
+ *
+ *  Each simulated room is a two-node thermal network: the heater element
+ *  warms the room through a coupling time constant and the room leaks to
+ *  the outside. The heater element's stored heat is what makes the
+ *  comparator overshoot, and what the controller has to anticipate.
+ *
+ *  All controllers see the same Q7 sensor readings once per second and
+ *  follow the same set-point schedule (button presses during the run).
+ *  For each room the tool reports:
+ *    - comfort error: mean |room - set-point| in C
+ *    - overshoot:     worst excursion above the set-point in C
+ *    - rise:          mean seconds from a set-point increase until the room
+ *                     is within riseTolerance of the new set-point
+ *    - on-time:       heater on-time in minutes
+ *    - switches:      heater off->on transitions
+ *
+ *  Build and run with "make thermaleval && ./thermaleval" from this directory.
+ *  Other controller settings can be tried with, for example,
+ *  make thermaleval CFLAGS="-O2 -DpreheatHorizon=120".
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "thermalmodel.h"
+
+/* Definitions */
+#define simulationSeconds (6 * 3600)
+#define simulationSubsteps 10
+#define riseTolerance 0.1           // C below the set-point that counts as reached
+
+enum CONTROLLERS {COMPARATOR, HYSTERESIS, MODEL, CONTROLLERS};
+
+static const char *controllerNames[CONTROLLERS] = { "comparator", "hysteresis", "model" };
+
+/*
+ *  ======== Room Type ========
+ */
+typedef struct room {
+    const char *name;
+    double roomTau;         // Room to outside time constant (s)
+    double heaterTau;       // Heater element to room time constant (s)
+    double heaterMass;      // Heater element heat capacity relative to the room
+    double heaterRise;      // Steady state rise above outside with the heater always on (C)
+    double outside;         // Outside temperature (C)
+} room;
+
+/*
+ *  ======== Result Type ========
+ */
+typedef struct result {
+    double comfortError;
+    double overshoot;
+    double rise;
+    double onMinutes;
+    unsigned int switches;
+} result;
+
+static const room rooms[] = {
+    { "small office",    1800.0,  90.0, 0.10, 30.0,  5.0 },
+    { "living room",     3600.0, 180.0, 0.20, 35.0,  0.0 },
+    { "radiator, slow",  5400.0, 300.0, 0.40, 25.0,  8.0 },
+    { "drafty",          1200.0, 120.0, 0.15, 40.0, -5.0 },
+    { "storage heater",  3600.0, 900.0, 1.00, 30.0,  5.0 },
+};
+
+/*
+ *  ======== setPointAt ========
+ *  Set-point schedule in whole degrees C, as the buttons would leave it.
+ */
+static int16_t setPointAt(int second)
+{
+    if (second < 1 * 3600)
+    {
+        return 20;
+    }
+    if (second < 2 * 3600)
+    {
+        return 23;
+    }
+    if (second < 4 * 3600)
+    {
+        return 21;
+    }
+    return 22;
+}
+
+/*
+ *  ======== sensorRead ========
+ *  Quantizes to the TMP11X resolution with one LSB of dither.
+ */
+static int16_t sensorRead(double temperature, unsigned int *seed)
+{
+    int noise;
+
+    *seed = *seed * 1103515245u + 12345u;
+    noise = (int)((*seed >> 16) % 3) - 1;
+
+    return (int16_t)(floor(temperature * 128.0) + noise);
+}
+
+/*
+ *  ======== simulate ========
+ *  Runs one room for simulationSeconds with one controller.
+ */
+static result simulate(const room *r, int controller)
+{
+    thermalModel model;
+    result res = { 0.0, 0.0, 0.0, 0.0, 0 };
+    unsigned int seed = 1;
+    double roomLoss = 1.0 / r->roomTau;
+    double coupling = r->heaterMass / r->heaterTau;
+    double power = r->heaterRise * roomLoss;
+    double room = 20.0;
+    double heater = 20.0;
+    double absError = 0.0;
+    bool heating = false;
+    bool settling = false;
+    bool rising = false;
+    int riseStart = 0;
+    int rises = 0;
+    int16_t lastSetPoint = setPointAt(0);
+    int second;
+    int step;
+
+    thermalModelInit(&model);
+
+    for (second = 0; second < simulationSeconds; ++second)
+    {
+        int16_t setPoint = setPointAt(second);
+        int16_t reading = sensorRead(room, &seed);
+        bool heat;
+
+        // After a set-point decrease the room has to coast down; that is
+        // not overshoot, so it is left out until the room gets there.
+        if (setPoint < lastSetPoint)
+        {
+            settling = true;
+        }
+        if (setPoint > lastSetPoint)
+        {
+            rising = true;
+            riseStart = second;
+        }
+        lastSetPoint = setPoint;
+
+        // Same decision setHeatMode() makes once per second.
+        switch (controller)
+        {
+            case MODEL:
+                thermalModelUpdate(&model, reading, heating);
+                heat = thermalModelControl(&model, heating, reading, setPoint * 128,
+                                           preheatHorizon, preheatHysteresis);
+                break;
+            case HYSTERESIS:
+                heat = heating ? reading < setPoint * 128 + preheatHysteresis / 2
+                               : reading < setPoint * 128 - preheatHysteresis / 2;
+                break;
+            default:
+                heat = (int16_t)(reading * 0.0078125) < setPoint;
+                break;
+        }
+
+        if (heat && !heating)
+        {
+            res.switches++;
+        }
+        heating = heat;
+
+        for (step = 0; step < simulationSubsteps; ++step)
+        {
+            double dt = 1.0 / simulationSubsteps;
+            double flow = coupling * (heater - room);
+
+            heater += dt * ((heating ? power : 0.0) - flow) / r->heaterMass;
+            room += dt * (flow - roomLoss * (room - r->outside));
+        }
+
+        if (heating)
+        {
+            res.onMinutes += 1.0 / 60.0;
+        }
+        absError += fabs(room - setPoint);
+        if (rising && room >= setPoint - riseTolerance)
+        {
+            rising = false;
+            res.rise += second + 1 - riseStart;
+            rises++;
+        }
+        if (room <= setPoint)
+        {
+            settling = false;
+        }
+        if (!settling && room - setPoint > res.overshoot)
+        {
+            res.overshoot = room - setPoint;
+        }
+    }
+
+    res.comfortError = absError / simulationSeconds;
+    if (rising)
+    {
+        // Never got there; count the rest of the run.
+        res.rise += simulationSeconds - riseStart;
+        rises++;
+    }
+    if (rises)
+    {
+        res.rise /= rises;
+    }
+
+    return res;
+}
+
+/*
+ *  ======== main ========
+ */
+int main(void)
+{
+    unsigned int i;
+    int c;
+
+    printf("%-16s %-11s %9s %9s %9s %9s %8s\n",
+           "room", "controller", "error C", "over C", "rise s", "on min", "switches");
+
+    for (i = 0; i < sizeof(rooms) / sizeof(rooms[0]); ++i)
+    {
+        for (c = 0; c < CONTROLLERS; ++c)
+        {
+            result res = simulate(&rooms[i], c);
+
+            printf("%-16s %-11s %9.3f %9.3f %9.0f %9.1f %8u\n", c == 0 ? rooms[i].name : "",
+                   controllerNames[c], res.comfortError, res.overshoot, res.rise, res.onMinutes, res.switches);
+        }
+    }
+
+    return 0;
+}
@@ -43,29 +43,28 @@
 #include <ti/drivers/I2C.h>
 #include <ti/drivers/Timer.h>
 #include <ti/drivers/UART.h>
+#include <ti/drivers/dpl/ClockP.h>
 
 /* Driver configuration */
 #include "ti_drivers_config.h"
 
+/* Heating and cooling rate estimator */
+#include "thermalmodel.h"
+
+/* Data-ready driven one-shot sensor acquisition */
+#include "oneshot.h"
+
+/* Heater duty-cycle accounting */
+#include "heataccount.h"
+
+/* Task table and scheduler */
+#include "tasks.h"
+
 /* Definitions */
 #define DISPLAY(x) UART_write(uart, &output, x)
-#define timerPeriod 100
-#define numTasks 3
-#define checkButtonPeriod 200
-#define checkTemperaturePeriod 500
-#define updateHeatModeAndServerPeriod 1000
-
-/*
- *  ======== Task Type ========
- *
- *  Defines structure for the task type.
- */
-typedef struct task {
-    int state;                    // Current state of the task
-    unsigned long period;         // Rate at which the task should tick
-    unsigned long elapsedTime;    // Time since task's previous tick
-    int (*tickFunction)(int);     // Function to call for task's tick
-} task;
+#define useOneShotAcquisition 1     // Use one-shot conversions on sensors that support them (0 = always poll)
+#define reportHeatAccounting 0      // 1 appends last hour's heater on-time and switch count to each report
+#define usePredictiveHeat 0         // 1 switches the heater on the learned thermal model (0 = plain comparator)
 
 /*
  *  ======== Driver Handles ========
@@ -80,6 +79,8 @@ UART_Handle uart;       // UART driver handle
 // UART global variables
 char output[64];
 int bytesToSend;
+char queryByte;                     // Byte received from the server
+volatile unsigned char QueryFlag = 0;
 
 // I2C global variables
 static const struct
@@ -87,16 +88,24 @@ static const struct
     uint8_t address;
     uint8_t resultReg;
     char *id;
+    bool oneShot;       // Supports one-shot conversions with a data-ready ALERT pin
 }
 sensors[3] = {
-    { 0x48, 0x0000, "11X" },
-    { 0x49, 0x0000, "116" },
-    { 0x41, 0x0001, "006" }
+    { 0x48, 0x0000, "11X", true },
+    { 0x49, 0x0000, "116", true },
+    { 0x41, 0x0001, "006", false }
 };
 uint8_t txBuffer[1];
 uint8_t rxBuffer[2];
 I2C_Transaction i2cTransaction;
 
+// One-shot acquisition global variables
+bool sensorTransfer(void *context, const uint8_t *writeBuf, size_t writeCount, uint8_t *readBuf, size_t readCount);
+uint32_t sensorMicroseconds(void *context);
+const sensorBus tmpBus = { sensorTransfer, sensorMicroseconds, NULL };
+oneShotSensor tmpSensor;
+bool sensorOneShot = false;     // Set by initI2C() when the detected sensor is read on data ready
+
 // Timer global variables
 volatile unsigned char TimerFlag = 0;
 
@@ -105,8 +114,11 @@ enum BUTTON_STATES {INCREASE_TEMPERATURE, DECREASE_TEMPERATURE, BUTTON_INIT} BUT
 enum TEMPERATURE_SENSOR_STATES {READ_TEMPERATURE, TEMPERATURE_SENSOR_INIT};                 // States for the temperature sensor.
 enum HEATING_STATES {HEAT_OFF, HEAT_ON, HEAT_INIT};                                         // States for the heating (heat/led off or on).
 int16_t ambientTemperature = 0;                                                             // Initialize temperature to 0 (will be updated by sensor reading).
+int16_t ambientTemperatureRaw = 0;                                                          // Full resolution sensor reading in Q7 (1/128C) for the thermal model.
 int16_t setPoint = 20;                                                                      // Initialize set-point for thermostat at 20C (68F).
 int seconds = 0;                                                                            // Initialize seconds to 0 (will be updated by timer).
+thermalModel roomModel;                                                                     // Learned heating and cooling rates of the room.
+heatAccount heatAccounting;                                                                 // Heater on-time, switches and comfort over rolling windows.
 
 /*
  *  ======== Callback ========
@@ -123,6 +135,22 @@ void gpioDecreaseTemperatureCallback(uint_least8_t index)
     BUTTON_STATE = DECREASE_TEMPERATURE;
 }
 
+// GPIO callback for the temperature sensor's ALERT pin (data ready).
+void gpioTemperatureReadyCallback(uint_least8_t index)
+{
+    oneShotDataReady(&tmpSensor);
+}
+
+// UART read callback. A '?' from the server requests the heater accounting.
+void uartReadCallback(UART_Handle handle, void *buf, size_t count)
+{
+    if (count == 1 && queryByte == '?')
+    {
+        QueryFlag = 1;
+    }
+    UART_read(handle, &queryByte, 1);  // Wait for the next byte
+}
+
 // Timer callback
 void timerCallback(Timer_Handle myHandle, int_fast16_t status)
 {
@@ -145,6 +173,8 @@ void initUART(void)
     uartParams.writeDataMode = UART_DATA_BINARY;
     uartParams.readDataMode = UART_DATA_BINARY;
     uartParams.readReturnMode = UART_RETURN_FULL;
+    uartParams.readMode = UART_MODE_CALLBACK;       // Reads complete in uartReadCallback() so the scheduler never blocks.
+    uartParams.readCallback = uartReadCallback;
     uartParams.baudRate = 115200;
 
     // Open the driver
@@ -154,6 +184,9 @@ void initUART(void)
         /* UART_open() failed */
         while (1);
     }
+
+    // Start listening for queries from the server
+    UART_read(uart, &queryByte, 1);
 }
 
 // Initialize I2C
@@ -211,6 +244,13 @@ void initI2C(void)
     if(found)
     {
         DISPLAY(snprintf(output, 64, "Detected TMP%s I2C address: %x\n\r", sensors[i].id, i2cTransaction.slaveAddress));
+
+        // Switch to one-shot conversions read on data ready where the sensor supports it.
+        if (useOneShotAcquisition && sensors[i].oneShot)
+        {
+            sensorOneShot = oneShotInit(&tmpSensor, &tmpBus);
+            DISPLAY(snprintf(output, 64, "One-shot acquisition %s\n\r", sensorOneShot ? "enabled" : "failed, polling"));
+        }
     }
     else
     {
@@ -250,6 +290,18 @@ void initGPIO(void)
         GPIO_enableInt(CONFIG_GPIO_BUTTON_1);
     }
 
+    /*
+     *  Temperature sensor ALERT pin, pulled low by the sensor when a conversion
+     *  is ready. Only wired up once initI2C() has set up one-shot acquisition;
+     *  the callback needs tmpSensor's bus.
+     */
+    if (sensorOneShot)
+    {
+        GPIO_setConfig(CONFIG_GPIO_TMP_ALERT, GPIO_CFG_IN_PU | GPIO_CFG_IN_INT_FALLING);
+        GPIO_setCallback(CONFIG_GPIO_TMP_ALERT, gpioTemperatureReadyCallback);
+        GPIO_enableInt(CONFIG_GPIO_TMP_ALERT);
+    }
+
     BUTTON_STATE = BUTTON_INIT;
 }
 
@@ -282,6 +334,28 @@ void initTimer(void)
     }
 }
 
+/*
+ *  ======== Sensor Bus ========
+ *  I2C and clock access used by the one-shot acquisition (see oneshot.h).
+ */
+bool sensorTransfer(void *context, const uint8_t *writeBuf, size_t writeCount, uint8_t *readBuf, size_t readCount)
+{
+    I2C_Transaction transaction = {0};
+
+    transaction.slaveAddress = i2cTransaction.slaveAddress;  // Address detected by initI2C()
+    transaction.writeBuf = (void *)writeBuf;
+    transaction.writeCount = writeCount;
+    transaction.readBuf = readBuf;
+    transaction.readCount = readCount;
+
+    return I2C_transfer(i2c, &transaction);
+}
+
+uint32_t sensorMicroseconds(void *context)
+{
+    return ClockP_getSystemTicks() * ClockP_getSystemTickPeriod();
+}
+
 /*
  *  ======== adjustSetPointTemperature ========
  *
@@ -333,6 +407,7 @@ int16_t readTemp(void)
         * The resulting value is multiplied by 0.0078125 to get degrees Celsius.
         */
         temperature = (rxBuffer[0] << 8) | (rxBuffer[1]);
+        ambientTemperatureRaw = temperature;  // Keep the full resolution reading for the thermal model
         temperature *= 0.0078125;
 
         /*
@@ -358,6 +433,8 @@ int16_t readTemp(void)
  *  ======== getAmbientTemperature ========
  *  This function checks the current state and determines if the temperature
  *  should be read from the sensor. It updates the ambient temperature accordingly.
+ *  In one-shot mode it only starts a conversion; the result is picked up by
+ *  serviceTemperatureReady() once the sensor signals data ready.
  */
 int getAmbientTemperature(int state)
 {
@@ -367,25 +444,100 @@ int getAmbientTemperature(int state)
             state = READ_TEMPERATURE;  // Transition to read temperature state
             break;
         case READ_TEMPERATURE:
-            ambientTemperature = readTemp();  // Read and update ambient temperature
+            if (sensorOneShot)
+            {
+                oneShotTrigger(&tmpSensor);  // Start a conversion, read it on data ready
+            }
+            else
+            {
+                ambientTemperature = readTemp();  // Read and update ambient temperature
+            }
             break;
     }
 
     return state;  // Return updated state
 }
 
+/*
+ *  ======== serviceTemperatureReady ========
+ *  Called while the scheduler waits for the next tick. Reads the sensor as
+ *  soon as a one-shot conversion has signalled data ready.
+ */
+void serviceTemperatureReady(void)
+{
+    int16_t raw;
+
+    if (sensorOneShot && oneShotService(&tmpSensor, &raw))
+    {
+        ambientTemperatureRaw = raw;
+        ambientTemperature = raw / 128;  // Q7 to whole degrees Celsius
+    }
+}
+
+/*
+ *  ======== reportToServer ========
+ *  Sends the status report with temperature, set point, heater state and
+ *  seconds, plus the optional heater accounting fields.
+ */
+void reportToServer(int state)
+{
+    if (reportHeatAccounting)
+    {
+        // Optional fields: heater on-time (s) and switch count over the last hour
+        DISPLAY(snprintf(output,
+                             64,
+                             "<%02d,%02d,%d,%04d,%lu,%lu>\n\r",
+                             ambientTemperature,
+                             setPoint,
+                             state,
+                             seconds,
+                             (unsigned long)heatAccountWindow(&heatAccounting, HEAT_HOUR)->onTime,
+                             (unsigned long)heatAccountWindow(&heatAccounting, HEAT_HOUR)->switches));
+    }
+    else
+    {
+        DISPLAY(snprintf(output,
+                             64,
+                             "<%02d,%02d,%d,%04d>\n\r",
+                             ambientTemperature,
+                             setPoint,
+                             state,
+                             seconds));
+    }
+}
+
 /*
  *  ======== setHeatMode ========
  *  This function compares the ambient temperature with the set-point temperature.
- *  It controls heating by turning an LED on or off based on the comparison.
+ *  With usePredictiveHeat it instead feeds the latest reading to the thermal
+ *  model and asks it whether to heat: a plain comparator until the model has
+ *  learned the room, then a band around the set-point switched ahead of time
+ *  by the learned lag. In thermaleval the model switches the heater far less
+ *  often but holds the room less closely than the comparator, so it is off
+ *  by default.
+ *  It controls heating by turning an LED on or off based on the decision.
  *  Additionally, it reports the current state to the server.
  */
 int setHeatMode(int state)
 {
+    bool heat;
+
     if (seconds != 0)
     {
-        // If the ambient temperature is below the set-point, turn on heating (LED on)
-        if (ambientTemperature < setPoint)
+        if (usePredictiveHeat)
+        {
+            // Credit the last second's temperature change to the heater state that caused it
+            thermalModelUpdate(&roomModel, ambientTemperatureRaw, state == HEAT_ON);
+            heat = thermalModelControl(&roomModel, state == HEAT_ON, ambientTemperatureRaw,
+                                       setPoint * 128, preheatHorizon, preheatHysteresis);
+        }
+        else
+        {
+            heat = ambientTemperature < setPoint;
+        }
+
+        // If the room needs heat, turn on heating (LED on)
+        if (heat)
         {
             GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_ON);
             state = HEAT_ON;
@@ -396,14 +548,11 @@ int setHeatMode(int state)
             state = HEAT_OFF;
         }
 
+        // Account this second's heater state and comfort
+        heatAccountTick(&heatAccounting, state == HEAT_ON, ambientTemperatureRaw, setPoint * 128);
+
         // Send status report to the server with temperature, set point, and state
-        DISPLAY(snprintf(output,
-                             64,
-                             "<%02d,%02d,%d,%04d>\n\r",
-                             ambientTemperature,
-                             setPoint,
-                             state,
-                             seconds));
+        reportToServer(state);
     }
 
     seconds++;  // Increment time counter
@@ -412,14 +561,46 @@ int setHeatMode(int state)
 }
 
 /*
- *  ======== mainThread ========
- *  The main application thread that initializes drivers and schedules tasks.
- *  Tasks are executed periodically to check temperature, adjust settings, and update the server.
+ *  ======== answerQuery ========
+ *  Replies to a '?' from the server with the heater accounting for the
+ *  rolling minute, hour and day windows, each as
+ *  on-time,switches,seconds above set-point,seconds below set-point:
+ *
+ *      {minute|hour|day}
  */
-void *mainThread(void *arg0)
+int answerQuery(int state)
 {
-    // Create an array of tasks for the system
-    task tasks[numTasks] = {
+    const heatTotals *minute, *hour, *day;
+
+    if (QueryFlag)
+    {
+        QueryFlag = 0;  // Reset the flag after reading
+
+        minute = heatAccountWindow(&heatAccounting, HEAT_MINUTE);
+        hour = heatAccountWindow(&heatAccounting, HEAT_HOUR);
+        day = heatAccountWindow(&heatAccounting, HEAT_DAY);
+        DISPLAY(snprintf(output,
+                             64,
+                             "{%lu,%lu,%lu,%lu|%lu,%lu,%lu,%lu|%lu,%lu,%lu,%lu}\n\r",
+                             (unsigned long)minute->onTime, (unsigned long)minute->switches,
+                             (unsigned long)minute->above, (unsigned long)minute->below,
+                             (unsigned long)hour->onTime, (unsigned long)hour->switches,
+                             (unsigned long)hour->above, (unsigned long)hour->below,
+                             (unsigned long)day->onTime, (unsigned long)day->switches,
+                             (unsigned long)day->above, (unsigned long)day->below));
+    }
+
+    return state;
+}
+
+/*
+ *  ======== initTasks ========
+ *  Fills the task table that mainThread() runs.
+ */
+void initTasks(task *tasks)
+{
+    // Task table for the system
+    static const task table[numTasks] = {
         // Task 1 - Button state check and set-point adjustment
         {
             .state = BUTTON_INIT,
@@ -440,32 +621,81 @@ void *mainThread(void *arg0)
             .period = updateHeatModeAndServerPeriod,
             .elapsedTime = updateHeatModeAndServerPeriod,
             .tickFunction = &setHeatMode
+        },
+        // Task 4 - Answer heater accounting queries from the server
+        {
+            .state = 0,
+            .period = checkQueryPeriod,
+            .elapsedTime = checkQueryPeriod,
+            .tickFunction = &answerQuery
         }
     };
+    unsigned int i;
+
+    for (i = 0; i < numTasks; ++i)
+    {
+        tasks[i] = table[i];
+    }
+
+    // One-shot conversions only need to run as often as the heat mode uses them.
+    // The heat task runs one tick behind, so each conversion (15.5 ms) is read
+    // on data ready before setHeatMode() uses it rather than a second later.
+    if (sensorOneShot)
+    {
+        tasks[1].period = oneShotPeriod;
+        tasks[1].elapsedTime = oneShotPeriod;
+        tasks[2].elapsedTime = updateHeatModeAndServerPeriod - timerPeriod;
+    }
+}
+
+/*
+ *  ======== runTasks ========
+ *  Runs one timer period of the scheduler: ticks every task whose period
+ *  has elapsed and advances the elapsed time of all tasks.
+ */
+void runTasks(task *tasks)
+{
+    unsigned int i = 0;
+    for (i = 0; i < numTasks; ++i)
+    {
+        // Execute task if its elapsed time meets the required period
+        if ( tasks[i].elapsedTime >= tasks[i].period )
+        {
+            tasks[i].state = tasks[i].tickFunction(tasks[i].state);  // Call task function
+            tasks[i].elapsedTime = 0;  // Reset elapsed time after execution
+         }
+         tasks[i].elapsedTime += timerPeriod;  // Increment elapsed time for each task
+    }
+}
+
+/*
+ *  ======== mainThread ========
+ *  The main application thread that initializes drivers and schedules tasks.
+ *  Tasks are executed periodically to check temperature, adjust settings, and update the server.
+ */
+void *mainThread(void *arg0)
+{
+    task tasks[numTasks];  // Array of tasks for the system
 
     // Initialize hardware drivers for UART, I2C, GPIO, and Timer
     initUART();
     initI2C();
     initGPIO();
     initTimer();
+    thermalModelInit(&roomModel);
+    heatAccountInit(&heatAccounting);
+    initTasks(tasks);
 
     // Infinite loop to continuously check and execute tasks
     while (1)
     {
-        unsigned int i = 0;
-        for (i = 0; i < numTasks; ++i)
+        runTasks(tasks);
+
+        // Wait for the timer period to expire, reading the sensor as soon as a conversion is ready
+        while(!TimerFlag)
         {
-            // Execute task if its elapsed time meets the required period
-            if ( tasks[i].elapsedTime >= tasks[i].period )
-            {
-                tasks[i].state = tasks[i].tickFunction(tasks[i].state);  // Call task function
-                tasks[i].elapsedTime = 0;  // Reset elapsed time after execution
-             }
-             tasks[i].elapsedTime += timerPeriod;  // Increment elapsed time for each task
+            serviceTemperatureReady();
         }
-
-        // Wait for the timer period to expire
-        while(!TimerFlag){}
         TimerFlag = 0;  // Reset the timer flag
     }
 
@@ -0,0 +1,111 @@
+/*
+ *  ======== heataccount.c ========
+ *  Rolling heater accounting. See heataccount.h for the window layout.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "heataccount.h"
+
+/* Sets up one window over its bucket storage. */
+static void heatWindowInit(heatWindow *window, heatBucket *buckets, uint8_t length, uint16_t bucketSeconds)
+{
+    uint8_t i;
+
+    for (i = 0; i < length; ++i)
+    {
+        buckets[i].onTime = 0;
+        buckets[i].switches = 0;
+        buckets[i].above = 0;
+        buckets[i].below = 0;
+    }
+
+    window->buckets = buckets;
+    window->length = length;
+    window->current = 0;
+    window->bucketSeconds = bucketSeconds;
+    window->elapsed = 0;
+    window->totals.onTime = 0;
+    window->totals.switches = 0;
+    window->totals.above = 0;
+    window->totals.below = 0;
+}
+
+/*
+ *  ======== heatWindowTick ========
+ *  Moves to the next bucket when the current one is full, dropping the
+ *  oldest bucket from the totals, then adds this second.
+ */
+static void heatWindowTick(heatWindow *window, bool on, bool switched, bool above, bool below)
+{
+    heatBucket *bucket;
+
+    if (window->elapsed == window->bucketSeconds)
+    {
+        window->elapsed = 0;
+        window->current++;
+        if (window->current == window->length)
+        {
+            window->current = 0;
+        }
+
+        bucket = &window->buckets[window->current];
+        window->totals.onTime -= bucket->onTime;
+        window->totals.switches -= bucket->switches;
+        window->totals.above -= bucket->above;
+        window->totals.below -= bucket->below;
+        bucket->onTime = 0;
+        bucket->switches = 0;
+        bucket->above = 0;
+        bucket->below = 0;
+    }
+
+    bucket = &window->buckets[window->current];
+    bucket->onTime += on;
+    bucket->switches += switched;
+    bucket->above += above;
+    bucket->below += below;
+    window->totals.onTime += on;
+    window->totals.switches += switched;
+    window->totals.above += above;
+    window->totals.below += below;
+    window->elapsed++;
+}
+
+/*
+ *  ======== heatAccountInit ========
+ */
+void heatAccountInit(heatAccount *account)
+{
+    heatWindowInit(&account->windows[HEAT_MINUTE], account->minute, heatMinuteBuckets, 1);
+    heatWindowInit(&account->windows[HEAT_HOUR], account->hour, heatHourBuckets, 60);
+    heatWindowInit(&account->windows[HEAT_DAY], account->day, heatDayBuckets, 3600);
+    account->lastHeating = false;
+}
+
+/*
+ *  ======== heatAccountTick ========
+ */
+void heatAccountTick(heatAccount *account, bool heating, int16_t temperature, int16_t setPoint)
+{
+    bool switched = heating && !account->lastHeating;
+    bool above = temperature > setPoint;
+    bool below = temperature < setPoint;
+    int i;
+
+    for (i = 0; i < HEAT_WINDOWS; ++i)
+    {
+        heatWindowTick(&account->windows[i], heating, switched, above, below);
+    }
+
+    account->lastHeating = heating;
+}
+
+/*
+ *  ======== heatAccountWindow ========
+ */
+const heatTotals *heatAccountWindow(const heatAccount *account, int window)
+{
+    return &account->windows[window].totals;
+}
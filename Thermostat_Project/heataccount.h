@@ -0,0 +1,79 @@
+/*
+ *  ======== heataccount.h ========
+ *  Heater duty-cycle accounting over rolling minute, hour and day windows.
+ *
+ *  Once per second setHeatMode() reports the heater state and whether the
+ *  room is above or below the set-point. Each window is a ring of buckets
+ *  (60 x 1 s, 60 x 1 min, 24 x 1 h) with running totals, so a tick touches
+ *  one bucket per window and reading a window is free. A window covers the
+ *  current bucket so far plus the previous length - 1 full buckets.
+ *  Integer only; no division on the tick path.
+ */
+#ifndef HEATACCOUNT_H_
+#define HEATACCOUNT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definitions */
+#define heatMinuteBuckets 60        // 1 s buckets
+#define heatHourBuckets 60          // 1 min buckets
+#define heatDayBuckets 24           // 1 h buckets
+
+enum HEAT_WINDOWS {HEAT_MINUTE, HEAT_HOUR, HEAT_DAY, HEAT_WINDOWS};
+
+/*
+ *  ======== Heat Bucket Type ========
+ *
+ *  Seconds (or counts) accumulated in one bucket. The largest bucket is one
+ *  hour, so 16 bits are enough.
+ */
+typedef struct heatBucket {
+    uint16_t onTime;        // Seconds with the heater on
+    uint16_t switches;      // Off to on transitions
+    uint16_t above;         // Seconds above the set-point
+    uint16_t below;         // Seconds below the set-point
+} heatBucket;
+
+/*
+ *  ======== Heat Totals Type ========
+ */
+typedef struct heatTotals {
+    uint32_t onTime;
+    uint32_t switches;
+    uint32_t above;
+    uint32_t below;
+} heatTotals;
+
+/*
+ *  ======== Heat Window Type ========
+ */
+typedef struct heatWindow {
+    heatBucket *buckets;
+    uint8_t length;         // Number of buckets
+    uint8_t current;        // Bucket being filled
+    uint16_t bucketSeconds; // Seconds per bucket
+    uint16_t elapsed;       // Seconds already in the current bucket
+    heatTotals totals;      // Sum over all buckets
+} heatWindow;
+
+/*
+ *  ======== Heat Account Type ========
+ */
+typedef struct heatAccount {
+    heatBucket minute[heatMinuteBuckets];
+    heatBucket hour[heatHourBuckets];
+    heatBucket day[heatDayBuckets];
+    heatWindow windows[HEAT_WINDOWS];
+    bool lastHeating;
+} heatAccount;
+
+void heatAccountInit(heatAccount *account);
+
+/* Adds one second. temperature and setPoint share a unit (the caller uses Q7 C). */
+void heatAccountTick(heatAccount *account, bool heating, int16_t temperature, int16_t setPoint);
+
+/* Totals for HEAT_MINUTE, HEAT_HOUR or HEAT_DAY. */
+const heatTotals *heatAccountWindow(const heatAccount *account, int window);
+
+#endif /* HEATACCOUNT_H_ */
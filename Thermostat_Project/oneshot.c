@@ -0,0 +1,177 @@
+/*
+ *  ======== oneshot.c ========
+ *  One-shot conversions read on the sensor's data-ready signal.
+ *  See oneshot.h for the sequence.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "oneshot.h"
+
+/*
+ *  ======== oneShotTransfer ========
+ *  Runs one transaction and keeps the bus statistics.
+ */
+static bool oneShotTransfer(oneShotSensor *sensor, const uint8_t *writeBuf, size_t writeCount,
+                            uint8_t *readBuf, size_t readCount)
+{
+    sensor->transactions++;
+    sensor->bytes += (uint32_t)(writeCount + readCount);
+    sensor->bytes += (writeCount ? 1 : 0) + (readCount ? 1 : 0);    // Address byte per (re)start
+
+    if (!sensor->bus->transfer(sensor->bus->context, writeBuf, writeCount, readBuf, readCount))
+    {
+        sensor->errors++;
+        return false;
+    }
+
+    return true;
+}
+
+/* Writes the configuration register. */
+static bool oneShotConfigure(oneShotSensor *sensor, uint16_t config)
+{
+    uint8_t txBuffer[3];
+
+    txBuffer[0] = tmp11xConfigReg;
+    txBuffer[1] = (uint8_t)(config >> 8);
+    txBuffer[2] = (uint8_t)(config & 0xFF);
+
+    return oneShotTransfer(sensor, txBuffer, 3, NULL, 0);
+}
+
+/*
+ *  ======== oneShotRelease ========
+ *  Reads a register and discards it. Writing the configuration does not
+ *  clear the sensor's Data_Ready flag; only reading the configuration or
+ *  result register does, and ALERT stays low (with no new edge for the
+ *  GPIO interrupt) until it is cleared.
+ */
+static bool oneShotRelease(oneShotSensor *sensor, uint8_t reg)
+{
+    uint8_t txBuffer[1];
+    uint8_t rxBuffer[2];
+
+    txBuffer[0] = reg;
+
+    return oneShotTransfer(sensor, txBuffer, 1, rxBuffer, 2);
+}
+
+/*
+ *  ======== oneShotInit ========
+ */
+bool oneShotInit(oneShotSensor *sensor, const sensorBus *bus)
+{
+    sensor->bus = bus;
+    sensor->dataReady = false;
+    sensor->readyTime = 0;
+    sensor->triggerTime = 0;
+    sensor->converting = false;
+    sensor->transactions = 0;
+    sensor->bytes = 0;
+    sensor->conversions = 0;
+    sensor->timeouts = 0;
+    sensor->errors = 0;
+    sensor->conversionTime = 0;
+    sensor->readLatency = 0;
+    sensor->readLatencyMax = 0;
+
+    if (!oneShotConfigure(sensor, tmp11xConfigShutdown))
+    {
+        return false;
+    }
+
+    // The sensor has been converting continuously since power-on, so the
+    // flag is likely set already; clear it before the interrupt is enabled.
+    return oneShotRelease(sensor, tmp11xConfigReg);
+}
+
+/*
+ *  ======== oneShotTrigger ========
+ */
+bool oneShotTrigger(oneShotSensor *sensor)
+{
+    uint32_t now = sensor->bus->microseconds(sensor->bus->context);
+
+    if (sensor->converting)
+    {
+        if (now - sensor->triggerTime < oneShotTimeout)
+        {
+            // Still converting; the next schedule tick will pick it up.
+            return false;
+        }
+        sensor->timeouts++;
+        sensor->converting = false;
+
+        // A missed edge leaves ALERT low; release it so the next one is seen.
+        oneShotRelease(sensor, tmp11xResultReg);
+    }
+
+    sensor->dataReady = false;
+    if (!oneShotConfigure(sensor, tmp11xConfigOneShot))
+    {
+        return false;
+    }
+
+    sensor->triggerTime = now;
+    sensor->converting = true;
+
+    return true;
+}
+
+/*
+ *  ======== oneShotDataReady ========
+ */
+void oneShotDataReady(oneShotSensor *sensor)
+{
+    sensor->readyTime = sensor->bus->microseconds(sensor->bus->context);
+    sensor->dataReady = true;
+}
+
+/*
+ *  ======== oneShotService ========
+ */
+bool oneShotService(oneShotSensor *sensor, int16_t *raw)
+{
+    uint8_t txBuffer[1] = { tmp11xResultReg };
+    uint8_t rxBuffer[2];
+    uint32_t latency;
+
+    if (!sensor->dataReady)
+    {
+        return false;
+    }
+    sensor->dataReady = false;
+
+    if (!sensor->converting)
+    {
+        // Edge without an outstanding conversion (e.g. the last continuous
+        // conversion finishing after oneShotInit()); nothing new to read,
+        // but the flag must be cleared or ALERT stays low.
+        oneShotRelease(sensor, tmp11xResultReg);
+        return false;
+    }
+    sensor->converting = false;
+
+    // Reading the result register also releases the ALERT pin.
+    if (!oneShotTransfer(sensor, txBuffer, 1, rxBuffer, 2))
+    {
+        // Try once more to release ALERT; otherwise the next trigger times out and retries.
+        oneShotRelease(sensor, tmp11xResultReg);
+        return false;
+    }
+
+    latency = sensor->bus->microseconds(sensor->bus->context) - sensor->readyTime;
+    sensor->conversions++;
+    sensor->conversionTime += sensor->readyTime - sensor->triggerTime;
+    sensor->readLatency += latency;
+    if (latency > sensor->readLatencyMax)
+    {
+        sensor->readLatencyMax = latency;
+    }
+
+    *raw = (int16_t)((rxBuffer[0] << 8) | rxBuffer[1]);
+
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ *  ======== oneshot.h ========
+ *  Interrupt driven one-shot acquisition for the TMP116/TMP11X sensors.
+ *
+ *  The sensor is kept in shutdown with its ALERT pin configured as a
+ *  data-ready output. On schedule, oneShotTrigger() starts a single
+ *  conversion; when it completes the sensor pulls ALERT low, the GPIO
+ *  callback calls oneShotDataReady(), and the main loop reads the result
+ *  in oneShotService(). The result register is never read speculatively,
+ *  and the sensor only draws active current while it is converting.
+ *
+ *  The I2C bus and the clock are reached through sensorBus so the same
+ *  code runs against a fake sensor on the host.
+ */
+#ifndef ONESHOT_H_
+#define ONESHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definitions */
+#define tmp11xResultReg 0x00
+#define tmp11xConfigReg 0x01
+#define tmp11xConfigShutdown 0x0404     // MOD = shutdown, ALERT pin = data ready (active low), AVG = 1 sample
+#define tmp11xConfigOneShot 0x0C04      // MOD = one-shot, otherwise as above
+#define oneShotTimeout 100000           // us without data ready before a conversion is written off
+
+/*
+ *  ======== Sensor Bus Type ========
+ *
+ *  transfer() performs one I2C transaction: writeCount bytes, then (after
+ *  a repeated start) readCount bytes; either count may be zero.
+ *  microseconds() must be safe to call from the GPIO callback.
+ */
+typedef struct sensorBus {
+    bool (*transfer)(void *context, const uint8_t *writeBuf, size_t writeCount,
+                     uint8_t *readBuf, size_t readCount);
+    uint32_t (*microseconds)(void *context);
+    void *context;
+} sensorBus;
+
+/*
+ *  ======== One-Shot Sensor Type ========
+ */
+typedef struct oneShotSensor {
+    const sensorBus *bus;
+    volatile bool dataReady;        // Set by oneShotDataReady()
+    volatile uint32_t readyTime;    // us when data ready fired
+    uint32_t triggerTime;           // us when the conversion was started
+    bool converting;                // A conversion is outstanding
+
+    // Statistics
+    uint32_t transactions;          // I2C transactions issued
+    uint32_t bytes;                 // Bytes on the wire, including address bytes
+    uint32_t conversions;           // Results read
+    uint32_t timeouts;              // Conversions that never signalled data ready
+    uint32_t errors;                // Failed transactions
+    uint64_t conversionTime;        // Sum of trigger to data ready (us)
+    uint64_t readLatency;           // Sum of data ready to result read (us)
+    uint32_t readLatencyMax;        // Worst data ready to result read (us)
+} oneShotSensor;
+
+/*
+ *  Puts the sensor in shutdown with data-ready signalling and clears any
+ *  pending data ready. Returns false if the sensor does not answer.
+ */
+bool oneShotInit(oneShotSensor *sensor, const sensorBus *bus);
+
+/* Starts a conversion unless one is still outstanding. Called on schedule. */
+bool oneShotTrigger(oneShotSensor *sensor);
+
+/* Records that the conversion finished. Called from the data-ready GPIO callback. */
+void oneShotDataReady(oneShotSensor *sensor);
+
+/* Reads the result if data ready has fired. Returns true with the raw Q7 reading in *raw. */
+bool oneShotService(oneShotSensor *sensor, int16_t *raw);
+
+#endif /* ONESHOT_H_ */
@@ -0,0 +1,44 @@
+/*
+ *  ======== tasks.h ========
+ *  The cooperative task table that mainThread() runs once per timer period.
+ *
+ *  Shared so the host benchmarks and acquireeval drive the same table and
+ *  periods the firmware uses, rather than copies of them.
+ */
+#ifndef TASKS_H_
+#define TASKS_H_
+
+/* Definitions */
+#define numTasks 4
+#define timerPeriod 100                         // ms per scheduler tick
+#define checkButtonPeriod 200
+#define checkTemperaturePeriod 500
+#define updateHeatModeAndServerPeriod 1000
+#define oneShotPeriod 1000                      // One conversion per heat mode update; anything faster is never used
+#define checkQueryPeriod 100
+
+/*
+ *  ======== Task Type ========
+ *
+ *  Defines structure for the task type.
+ */
+typedef struct task {
+    int state;                    // Current state of the task
+    unsigned long period;         // Rate at which the task should tick
+    unsigned long elapsedTime;    // Time since task's previous tick
+    int (*tickFunction)(int);     // Function to call for task's tick
+} task;
+
+/*
+ *  Fills tasks[numTasks] with the firmware's tasks. Call after initI2C(),
+ *  which decides whether the sensor runs one-shot conversions.
+ */
+void initTasks(task *tasks);
+
+/*
+ *  Runs one timer period: ticks every task whose period has elapsed and
+ *  advances the elapsed time of all tasks.
+ */
+void runTasks(task *tasks);
+
+#endif /* TASKS_H_ */
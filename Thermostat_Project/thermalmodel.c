@@ -0,0 +1,338 @@
+/*
+ *  ======== thermalmodel.c ========
+ *  Incremental least squares fit of the room's heating and cooling rates.
+ *  See thermalmodel.h for the model and the fixed point formats.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "thermalmodel.h"
+
+/*
+ *  ======== Thermal Line Type ========
+ *
+ *  Fitted line for one heater state, ready for evaluation:
+ *  rate(x) = meanY + slope * (x - meanX)
+ */
+typedef struct thermalLine {
+    int32_t meanX;  // Q16 C offset from thermalModelRef
+    int32_t meanY;  // Q16 C per sample
+    int32_t slope;  // Q16 per sample
+} thermalLine;
+
+static int32_t clamp(int32_t value, int32_t limit)
+{
+    if (value > limit)
+    {
+        return limit;
+    }
+    if (value < -limit)
+    {
+        return -limit;
+    }
+    return value;
+}
+
+/*
+ *  ======== thermalFitAdd ========
+ *  Decays the running sums by the forgetting factor and adds one sample.
+ */
+static void thermalFitAdd(thermalFit *fit, int32_t x, int32_t y)
+{
+    fit->n   -= fit->n   >> thermalModelForgetShift;
+    fit->sx  -= fit->sx  >> thermalModelForgetShift;
+    fit->sy  -= fit->sy  >> thermalModelForgetShift;
+    fit->sxx -= fit->sxx >> thermalModelForgetShift;
+    fit->sxy -= fit->sxy >> thermalModelForgetShift;
+
+    fit->n   += thermalModelWeight;
+    fit->sx  += (int64_t)thermalModelWeight * x;
+    fit->sy  += (int64_t)thermalModelWeight * y;
+    fit->sxx += (int64_t)thermalModelWeight * x * x;
+    fit->sxy += (int64_t)thermalModelWeight * x * y;
+
+    if (fit->count < thermalModelMinSamples)
+    {
+        fit->count++;
+    }
+}
+
+/*
+ *  ======== thermalFitLine ========
+ *  Solves the normal equations for the fit. When the samples are bunched
+ *  too closely in temperature to resolve a slope, the mean rate is used.
+ *  A positive slope (a room that loses less heat the warmer it gets) is
+ *  not physical and is clamped to zero so predictions cannot run away.
+ */
+static void thermalFitLine(const thermalFit *fit, thermalLine *line)
+{
+    int64_t n = fit->n;
+    int64_t det;
+    int64_t slope;
+
+    line->meanX = 0;
+    line->meanY = 0;
+    line->slope = 0;
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    line->meanX = (int32_t)((fit->sx * 512) / n);
+    line->meanY = (int32_t)((fit->sy * 512) / n);
+
+    det = n * fit->sxx - fit->sx * fit->sx;
+    if (det < n * n * thermalModelMinSpread * thermalModelMinSpread)
+    {
+        return;
+    }
+
+    slope = ((n * fit->sxy - fit->sx * fit->sy) * (1 << thermalRateShift)) / det;
+    if (slope > 0)
+    {
+        slope = 0;
+    }
+    if (slope < -(1 << thermalRateShift))
+    {
+        slope = -(1 << thermalRateShift);
+    }
+    line->slope = (int32_t)slope;
+}
+
+/* Evaluates the line at x (Q16 C offset from thermalModelRef). */
+static int32_t thermalLineRate(const thermalLine *line, int32_t x)
+{
+    return line->meanY + (int32_t)(((int64_t)line->slope * (x - line->meanX)) >> thermalRateShift);
+}
+
+/*
+ *  ======== thermalModelInit ========
+ */
+void thermalModelInit(thermalModel *model)
+{
+    unsigned int i;
+
+    for (i = 0; i < 2; ++i)
+    {
+        model->fit[i].n = 0;
+        model->fit[i].sx = 0;
+        model->fit[i].sy = 0;
+        model->fit[i].sxx = 0;
+        model->fit[i].sxy = 0;
+        model->fit[i].count = 0;
+    }
+    model->lastTemp = 0;
+    model->hasLast = false;
+    model->lastHeating = false;
+    model->held = 0;
+    for (i = 0; i < 2; ++i)
+    {
+        model->turn[i] = 0;
+        model->lag[i] = 0;
+        model->lagKnown[i] = false;
+    }
+    model->tracking = false;
+    model->since = 0;
+    model->switchTemp = 0;
+    model->switchRate = 0;
+    model->extreme = 0;
+    model->extremeAt = 0;
+}
+
+/* Moves a Q4 average 1/2^thermalLagShift of the way to a new sample. */
+static uint16_t thermalLagAverage(uint16_t average, int32_t sample, bool known)
+{
+    int32_t value = average;
+
+    if (sample < 0)
+    {
+        sample = 0;
+    }
+    if (sample > thermalLagLimit * 16)
+    {
+        sample = thermalLagLimit * 16;
+    }
+    value = known ? value + (sample - value) / (1 << thermalLagShift) : sample;
+
+    return (uint16_t)value;
+}
+
+/*
+ *  ======== thermalLagUpdate ========
+ *  Follows the temperature after a switch until it turns, then folds the
+ *  samples it took and the distance it carried on into the averages for
+ *  that heater state.
+ */
+static void thermalLagUpdate(thermalModel *model, int16_t temperature, bool heating)
+{
+    unsigned int state = heating ? 1 : 0;
+    int32_t carry;
+
+    if (heating != model->lastHeating)
+    {
+        // The switch happened at the previous sample.
+        model->held = 0;
+        model->tracking = true;
+        model->since = 0;
+        model->switchTemp = model->lastTemp;
+        model->switchRate = thermalModelRate(model, model->lastHeating, model->lastTemp);
+        model->extreme = model->lastTemp;
+        model->extremeAt = 0;
+    }
+    if (model->held < UINT16_MAX)
+    {
+        model->held++;
+    }
+    if (!model->tracking)
+    {
+        return;
+    }
+
+    model->since++;
+    if (heating ? temperature < model->extreme : temperature > model->extreme)
+    {
+        model->extreme = temperature;
+        model->extremeAt = model->since;
+    }
+    else if (heating ? temperature >= model->extreme + thermalLagMargin
+                     : temperature <= model->extreme - thermalLagMargin)
+    {
+        model->tracking = false;
+
+        // After switching on the room carries on cooling (off rate < 0),
+        // after switching off it carries on warming (on rate > 0).
+        carry = (int32_t)model->extreme - model->switchTemp;
+        if (heating ? model->switchRate > -thermalLagMinRate : model->switchRate < thermalLagMinRate)
+        {
+            return;     // Rate too small or the wrong way to scale by
+        }
+
+        model->turn[state] = thermalLagAverage(model->turn[state], (int32_t)model->extremeAt * 16,
+                                               model->lagKnown[state]);
+        model->lag[state] = thermalLagAverage(model->lag[state],
+                                              (int32_t)(((int64_t)carry * 512 * 16) / model->switchRate),
+                                              model->lagKnown[state]);
+        model->lagKnown[state] = true;
+    }
+    else if (model->since >= thermalLagLimit)
+    {
+        model->tracking = false;    // Never turned; nothing to learn
+    }
+}
+
+/*
+ *  ======== thermalModelUpdate ========
+ */
+void thermalModelUpdate(thermalModel *model, int16_t temperature, bool heating)
+{
+    if (model->hasLast)
+    {
+        int32_t x = clamp((int32_t)model->lastTemp - thermalModelRef, thermalModelSpan);
+        int32_t y = clamp((int32_t)temperature - model->lastTemp, thermalModelStepLimit);
+
+        thermalFitAdd(&model->fit[heating ? 1 : 0], x, y);
+        thermalLagUpdate(model, temperature, heating);
+    }
+
+    model->lastTemp = temperature;
+    model->hasLast = true;
+    model->lastHeating = heating;
+}
+
+/*
+ *  ======== thermalModelReady ========
+ */
+bool thermalModelReady(const thermalModel *model)
+{
+    return model->fit[0].count >= thermalModelMinSamples
+        && model->fit[1].count >= thermalModelMinSamples;
+}
+
+/*
+ *  ======== thermalModelRate ========
+ */
+int32_t thermalModelRate(const thermalModel *model, bool heating, int16_t temperature)
+{
+    thermalLine line;
+    int32_t x = clamp((int32_t)temperature - thermalModelRef, thermalModelSpan) * 512;
+
+    thermalFitLine(&model->fit[heating ? 1 : 0], &line);
+
+    return thermalLineRate(&line, x);
+}
+
+/*
+ *  ======== thermalModelTurn ========
+ */
+uint16_t thermalModelTurn(const thermalModel *model, bool heating)
+{
+    return (uint16_t)((model->turn[heating ? 1 : 0] + 8) >> 4);
+}
+
+/*
+ *  ======== thermalModelLag ========
+ */
+uint16_t thermalModelLag(const thermalModel *model, bool heating)
+{
+    return (uint16_t)((model->lag[heating ? 1 : 0] + 8) >> 4);
+}
+
+/*
+ *  ======== thermalModelPredict ========
+ *  Steps the fitted line forward one sample at a time, which follows the
+ *  exponential approach to the room's equilibrium instead of extrapolating
+ *  the current rate in a straight line.
+ */
+int16_t thermalModelPredict(const thermalModel *model, bool heating, int16_t temperature, uint16_t samples)
+{
+    thermalLine line;
+    int32_t limit = thermalModelSpan * 512;
+    int32_t x = clamp((int32_t)temperature - thermalModelRef, thermalModelSpan) * 512;
+    uint16_t i;
+
+    thermalFitLine(&model->fit[heating ? 1 : 0], &line);
+
+    for (i = 0; i < samples; ++i)
+    {
+        x = clamp(x + thermalLineRate(&line, x), limit);
+    }
+
+    return (int16_t)((x >> 9) + thermalModelRef);
+}
+
+/*
+ *  ======== thermalModelControl ========
+ */
+bool thermalModelControl(const thermalModel *model, bool heating, int16_t temperature,
+                         int16_t setPoint, uint16_t horizon, int16_t hysteresis)
+{
+    uint16_t lag;
+
+    if (!thermalModelReady(model))
+    {
+        return temperature < setPoint;
+    }
+
+    // Until the room has turned after the last switch, hold the heater
+    // unless the room has already left the band.
+    if (model->held < thermalModelTurn(model, heating))
+    {
+        return heating ? temperature < setPoint + hysteresis / 2
+                       : temperature < setPoint - hysteresis / 2;
+    }
+
+    if (heating)
+    {
+        // Stop once the heat still stored in the heater will carry the room to the top of the band.
+        lag = thermalModelLag(model, false);
+        lag = lag < horizon ? lag : horizon;
+        return thermalModelPredict(model, true, temperature, lag) < setPoint + hysteresis / 2;
+    }
+
+    // Start early enough that the room bottoms out at the bottom of the band.
+    lag = thermalModelLag(model, true);
+    lag = lag < horizon ? lag : horizon;
+    return thermalModelPredict(model, false, temperature, lag) < setPoint - hysteresis / 2;
+}
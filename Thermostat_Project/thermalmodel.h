@@ -0,0 +1,131 @@
+/*
+ *  ======== thermalmodel.h ========
+ *  Online estimator for the room's heating and cooling rates.
+ *
+ *  Each heater state (off/on) keeps its own first-order fit of the
+ *  temperature change over one sample against the temperature at the start
+ *  of the sample:
+ *
+ *      dT = a + b * (T - thermalModelRef)
+ *
+ *  The fit is an incremental least squares over running sums. The sums are
+ *  decayed by 1 - 2^-thermalModelForgetShift on every update, so the model
+ *  follows slow changes in the room without keeping a sample history.
+ *
+ *  The heater element stores heat, so the room keeps moving the old way for
+ *  a while after every switch: it keeps warming after the heater stops and
+ *  keeps cooling after it starts, until it turns (the peak after switching
+ *  off, the trough after switching on). For each switch direction the model
+ *  learns, averaged over recent switches:
+ *    - the turn: samples from the switch to the peak or trough
+ *    - the lag:  how far the room carried on, expressed in samples at the
+ *                fitted rate of the state before the switch, so the
+ *                carry-over scales with the rates as the room changes
+ *
+ *  Everything is fixed point and statically sized:
+ *    - temperatures are Q7 degrees C (the TMP11X native 1/128 C resolution)
+ *    - rates are Q16 degrees C per sample
+ */
+#ifndef THERMALMODEL_H_
+#define THERMALMODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definitions */
+#define thermalModelRef 2560            // Q7 C (20 C) the fits are centered on
+#define thermalModelSpan 4096           // Q7 C (32 C) clamp on distance from thermalModelRef
+#define thermalModelStepLimit 1024      // Q7 C (8 C) clamp on the change over one sample
+#define thermalModelMinSpread 32        // Q7 C (0.25 C) spread in x needed before fitting a slope
+#define thermalModelWeight 16           // Weight of one sample in the running sums
+#define thermalModelForgetShift 8       // Forgetting factor 1 - 1/256 (~4 minutes at 1 Hz)
+#define thermalModelMinSamples 32       // Samples per heater state before the fit is trusted
+#define thermalRateShift 16             // Rates are returned in Q16
+#define thermalLagMargin 4              // Q7 C past the extreme that confirms the temperature turned
+#define thermalLagLimit 900             // Samples after a switch to wait for the turn
+#define thermalLagShift 2               // Each new turn and lag moves the average 1/4 of the way
+#define thermalLagMinRate 64            // Q16 C per sample (~0.1 C per hour) below which a rate cannot scale a lag
+
+/* Controller tuning used by setHeatMode() and thermaleval; override with -D */
+#ifndef preheatHorizon
+#define preheatHorizon 60               // Longest look-ahead (s) the heat controller may learn
+#endif
+#ifndef preheatHysteresis
+#define preheatHysteresis 24            // Q7 C (0.1875 C) width of the band held around the set-point
+#endif
+
+/*
+ *  ======== Thermal Fit Type ========
+ *
+ *  Running least squares sums for one heater state.
+ *  x is the temperature offset from thermalModelRef (Q7 C),
+ *  y is the change in temperature over the sample (Q7 C).
+ */
+typedef struct thermalFit {
+    int32_t n;      // Sum of weights
+    int64_t sx;     // Sum of weight * x
+    int64_t sy;     // Sum of weight * y
+    int64_t sxx;    // Sum of weight * x * x
+    int64_t sxy;    // Sum of weight * x * y
+    uint16_t count; // Samples seen, saturating at thermalModelMinSamples
+} thermalFit;
+
+/*
+ *  ======== Thermal Model Type ========
+ */
+typedef struct thermalModel {
+    thermalFit fit[2];      // Indexed by heater state (0 = off, 1 = on)
+    int16_t lastTemp;       // Temperature at the previous update (Q7 C)
+    bool hasLast;           // lastTemp holds a valid sample
+    bool lastHeating;       // Heater state of the previous update
+    uint16_t held;          // Samples in the current heater state, saturating
+
+    // Carry-over after switching to each heater state
+    uint16_t turn[2];       // Q4 samples from the switch to the peak or trough
+    uint16_t lag[2];        // Q4 samples at the previous state's rate the carry-over is worth
+    bool lagKnown[2];       // At least one switch to the state has been followed through
+    bool tracking;          // Waiting for the temperature to turn after a switch
+    uint16_t since;         // Samples since the switch
+    int16_t switchTemp;     // Temperature at the switch (Q7 C)
+    int32_t switchRate;     // Fitted rate of the previous state at the switch (Q16 C per sample)
+    int16_t extreme;        // Peak (after off) or trough (after on) so far (Q7 C)
+    uint16_t extremeAt;     // Samples from the switch to the extreme
+} thermalModel;
+
+void thermalModelInit(thermalModel *model);
+
+/*
+ *  Add a sample. heating is the heater state that was in force since the
+ *  previous call, so the temperature change is credited to the right fit.
+ */
+void thermalModelUpdate(thermalModel *model, int16_t temperature, bool heating);
+
+/* True once both heater states have enough samples to be trusted. */
+bool thermalModelReady(const thermalModel *model);
+
+/* Predicted temperature change over one sample (Q16 C) at the given temperature. */
+int32_t thermalModelRate(const thermalModel *model, bool heating, int16_t temperature);
+
+/* Learned turn (samples) after switching the heater to the given state; 0 until learned. */
+uint16_t thermalModelTurn(const thermalModel *model, bool heating);
+
+/* Learned lag (samples) after switching the heater to the given state; 0 until learned. */
+uint16_t thermalModelLag(const thermalModel *model, bool heating);
+
+/* Predicted temperature (Q7 C) after holding the heater state for the given number of samples. */
+int16_t thermalModelPredict(const thermalModel *model, bool heating, int16_t temperature, uint16_t samples);
+
+/*
+ *  Decide the heater state for the next sample. Falls back to the plain
+ *  comparator (temperature < setPoint) until thermalModelReady().
+ *  Afterwards the room is held in a band hysteresis wide centered on the
+ *  set-point, switching early by the learned lag (capped at horizon
+ *  samples): the heater stops when the room, still heating for the lag
+ *  after switch-off, is predicted to reach the top of the band, and starts
+ *  when the room, still cooling for the lag after switch-on, is predicted
+ *  to reach the bottom.
+ */
+bool thermalModelControl(const thermalModel *model, bool heating, int16_t temperature,
+                         int16_t setPoint, uint16_t horizon, int16_t hysteresis);
+
+#endif /* THERMALMODEL_H_ */